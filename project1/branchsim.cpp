@@ -2,27 +2,127 @@
 
 /**
  * XXX: You are welcome to define and set any global classes and variables as needed.
+ *
+ * All predictor state is thread_local, so each thread can set up and run its own configuration.
  */
 
 //pointer to the pattern history table
-int *pht;
+thread_local int *pht;
 //pointer to the history register table
-int *hrt;
+thread_local int *hrt;
 //global variable to track which predictor type to use at all stages
-predictor_type currType;
+thread_local predictor_type currType;
 //a range for the counter_bits. Ex: counter_bits 3 will set this number to 7 denoting 0-7
-int counter_range;
+thread_local int counter_range;
 //a range for the history_bits. Ex: history_bits 2 will set this number to 3 denoting 0-3
-int history_range;
+thread_local int history_range;
 //index_mask initialized to keep uint64_t indexing within the length of however many bits num_entries is
-static std::uint64_t index_mask;
+static thread_local std::uint64_t index_mask;
 //hist_value is a global variable used to track the current value of the bits in the hrt
-int hist_value;
+thread_local int hist_value;
 
 //length of the localHistory pht
-int localHistoryPHTLength;
+thread_local int localHistoryPHTLength;
 //length of the localHistory hrt
-int localHistoryHRTLength;
+thread_local int localHistoryHRTLength;
+
+//hash used to pick a branch's entry in the local and two level predictors
+thread_local index_hash currHash = HASH_MULTIPLICATIVE;
+//hash chosen by set_index_hash, which setup_predictor makes current
+thread_local index_hash nextHash = HASH_MULTIPLICATIVE;
+//number of bits in an entry index, log2(num_entries)
+thread_local int index_bits;
+
+/**
+ * Subroutine for choosing how the local history and two level adaptive predictors map a PC to an
+ * entry. Takes effect at the next setup_predictor.
+ *
+ * @param[in]   hash        The index hash function
+ */
+void set_index_hash(index_hash hash) {
+	nextHash = hash;
+}
+
+/**
+ * Helper function that hashes a PC into an entry number in [0, num_entries) using the current
+ * (non-multiplicative) index hash
+ *
+ * @param  pc         PC of the branch
+ */
+std::uint64_t entry_index(std::uint64_t pc) {
+	//xor every index_bits wide slice of the pc together so all address bits contribute
+	if (currHash == 'X') {
+		std::uint64_t folded = 0;
+		while (index_bits > 0 && pc != 0) {
+			folded ^= pc & index_mask;
+			pc >>= index_bits;
+		}
+		return folded;
+	//skew the low slice with a one-bit rotate (the top bit becomes the xor of the end bits) and xor in the next slice
+	} else if (currHash == 'S' && index_bits > 1) {
+		std::uint64_t low = pc & index_mask;
+		std::uint64_t high = (pc >> index_bits) & index_mask;
+		std::uint64_t top = ((low ^ (low >> (index_bits - 1))) & 1) << (index_bits - 1);
+		return ((low >> 1) | top) ^ high;
+	//select the address bits above the 4-byte instruction alignment
+	} else if (currHash == 'A') {
+		return (pc >> 2) & index_mask;
+	}
+	return pc & index_mask;
+}
+
+/**
+ * Helper function that returns where a branch's history bits start in the hrt. The multiplicative
+ * hash keeps the original overlapping layout, every other hash gives each entry its own slot.
+ *
+ * @param  pc         PC of the branch
+ */
+int history_index(std::uint64_t pc) {
+	if (currHash == 'M') {
+		return (pc * (history_range + 1)) & index_mask;
+	}
+	return entry_index(pc) * (history_range + 1);
+}
+
+/**
+ * Helper function that returns where a branch's pattern table starts in the local history pht
+ *
+ * @param  pc         PC of the branch
+ */
+int pattern_index(std::uint64_t pc) {
+	if (currHash == 'M') {
+		return (pc * localHistoryPHTLength) & index_mask;
+	}
+	return entry_index(pc) << (history_range + 1);
+}
+
+/**
+ * Subroutine that computes the storage overhead (in bits) of a predictor configuration without
+ * allocating any of its tables. setup_predictor reports the same value in p_stats.
+ *
+ * @param[in]   ptype       The type of branch predictor
+ * @param[in]   num_entries The number of entries a PC is hashed into
+ * @param[in]   counter_bits The number of bits per counter
+ * @param[in]   history_bits The number of bits per history
+ *
+ * @return                  Storage overhead in bits
+ */
+std::uint64_t predictor_storage(predictor_type ptype, int num_entries, int counter_bits, int history_bits) {
+	//bimodal -> size of pht
+	if (ptype == 'B') {
+		return (std::uint64_t)num_entries * counter_bits;
+	//gshare -> size of pht + # of history bits
+	} else if (ptype == 'G') {
+		return (std::uint64_t)num_entries * counter_bits + history_bits;
+	//local history -> size of pht per # of history bits + # of history entries * history bits
+	} else if (ptype == 'L') {
+		return ((std::uint64_t)1 << history_bits) * counter_bits * num_entries + (std::uint64_t)history_bits * num_entries;
+	//two level adaptive -> size of prt (counter bits * # of combinations of history bits) + size of hrt
+	} else if (ptype == 'T') {
+		return (std::uint64_t)counter_bits * ((std::uint64_t)1 << history_bits) + (std::uint64_t)history_bits * num_entries;
+	}
+	return 0;
+}
 
 /**
  * Subroutine for initializing the branch predictor. You many add and initialize any global or heap
@@ -41,17 +141,24 @@ void setup_predictor(predictor_type ptype, int num_entries, int counter_bits, in
 	//initialize global variables across the board for all predictors
 	//set currType to the predictor we are using
 	currType = ptype;
+	//the whole run indexes with the hash chosen before it
+	currHash = nextHash;
 	//set counter_range to the upper decimal number in the counter_bits range
 	counter_range = (1 << counter_bits) - 1;
 	//set history_range to the upper decimal number in the history_bits range
 	history_range = history_bits - 1;
 	//set up the index_mask so indexing will always be in range
 	index_mask = (std::uint64_t)num_entries - 1;
+	//count the bits in index_mask for the index hashes
+	index_bits = 0;
+	while (((std::uint64_t)1 << index_bits) < (std::uint64_t)num_entries) {
+		index_bits++;
+	}
 
 	//if bimodal
 	if (ptype == 'B') {
 		//calculate storage_overhead -> size of pht
-		p_stats->storage_overhead = num_entries * counter_bits;
+		p_stats->storage_overhead = predictor_storage(ptype, num_entries, counter_bits, history_bits);
 		//initialize pht, we're using decimal numbers so single array.
 		//set all values to -1 to represent no prior entry
 		pht = new int [num_entries];
@@ -75,13 +182,13 @@ void setup_predictor(predictor_type ptype, int num_entries, int counter_bits, in
 				hrt[i] = 0;
 			}
 			//calculate gshare overhead -> size of pht + # of history bits
-			p_stats->storage_overhead = num_entries * counter_bits + history_bits;
+			p_stats->storage_overhead = predictor_storage(ptype, num_entries, counter_bits, history_bits);
 		}
 
 		//if local history
 	} else if (ptype == 'L') {
 		//calculate local history overhead -> size of pht per # of history bits + # of history entries * history bits
-		p_stats->storage_overhead = (1 << history_bits) * counter_bits * num_entries + history_bits * num_entries;
+		p_stats->storage_overhead = predictor_storage(ptype, num_entries, counter_bits, history_bits);
 
 		//set global lengths for pht and hrt to be tracked
 		localHistoryPHTLength = num_entries * (1 << history_bits) + 1;
@@ -103,7 +210,7 @@ void setup_predictor(predictor_type ptype, int num_entries, int counter_bits, in
 		//if two level adaptive
 	} else if (ptype == 'T') {
 		//calculate overhead for two level adaptive -> size of hrt + size of prt (counter bits * # of combinations of history bits)
-		p_stats->storage_overhead = counter_bits * (1 << history_bits) + history_bits * num_entries;
+		p_stats->storage_overhead = predictor_storage(ptype, num_entries, counter_bits, history_bits);
 
 		//initialize pht and hrt
 		pht = new int [(1 << history_bits)];
@@ -190,7 +297,7 @@ branch_dir predict_branch(std::uint64_t pc, branch_stats_t* p_stats) {
 		//set value from the history table to 0
 		hist_value = 0;
 		//initialize dist to the index of the current branch in the history table
-		int dist = (pc * (history_range + 1)) & index_mask;
+		int dist = history_index(pc);
 		//loop through all bits located in the history table and perform leftshifts to get values of each bit
 		//sum all values to get history value
 		for (int i = dist + history_range; i >= dist; i--) {
@@ -198,7 +305,7 @@ branch_dir predict_branch(std::uint64_t pc, branch_stats_t* p_stats) {
 		}
 
 		//initialize phtDist to the index of the current branch in the pht table and grab element
-		int phtDist = (pc * localHistoryPHTLength) & index_mask;
+		int phtDist = pattern_index(pc);
 		int element = pht[phtDist + hist_value];
 
 		//if this is the first time we're grabbing the element, set it to weakly taken and put weakly taken in the pht
@@ -221,7 +328,7 @@ branch_dir predict_branch(std::uint64_t pc, branch_stats_t* p_stats) {
 		//set value from the history table to 0
 		hist_value = 0;
 		//initialize dist to the index of the current branch in the history table
-		int dist = (pc * (history_range + 1)) & index_mask;
+		int dist = history_index(pc);
 		for (int i = dist + history_range; i >= dist; i--) {
 			hist_value += hrt[i] << (i - dist);
 		}
@@ -326,13 +433,13 @@ void update_predictor(std::uint64_t pc, branch_dir actual, branch_dir predicted,
 		//set history register table value to 0
 		hist_value = 0;
 		//initialize dist to the index of the current branch in the history table
-		int dist = (pc * (history_range + 1)) & index_mask;
+		int dist = history_index(pc);
 		//loop through hrt to find history branch value
 		for (int i = dist + history_range; i >= dist; i--) {
 			hist_value += hrt[i] << (i - dist);
 		}
 		//update hrt by shifting the values to the next highest index while overwriting the highest index value
-		for (int i = dist + history_range; i >= dist; i--) {
+		for (int i = dist + history_range; i > dist; i--) {
 			hrt[i] = hrt[i-1];
 		}
 		//if branch wasn't taken, set hrt lowest index in that branch to 0
@@ -344,7 +451,7 @@ void update_predictor(std::uint64_t pc, branch_dir actual, branch_dir predicted,
 		}
 
 		//set phtDist to the starting index of the pht related to the current branch
-		int phtDist = (pc * localHistoryPHTLength) & index_mask;
+		int phtDist = pattern_index(pc);
 		//grab element in pht
 		int element = pht[phtDist + hist_value];
 
@@ -366,13 +473,13 @@ void update_predictor(std::uint64_t pc, branch_dir actual, branch_dir predicted,
 		//set hrt variable to 0
 		hist_value = 0;
 		//obtain hrt starting, mask it to prevent indexing out of range
-		int dist = (pc * (history_range + 1)) & index_mask;
+		int dist = history_index(pc);
 		//loop through hrt to find history branch value
 		for (int i = dist + history_range; i >= dist; i--) {
 			hist_value += hrt[i] << (i - dist);
 		}
 		//update hrt by shifting the values to the next highest index while overwriting the highest index value
-		for (int i = dist + history_range; i >= dist; i--) {
+		for (int i = dist + history_range; i > dist; i--) {
 			hrt[i] = hrt[i-1];
 		}
 		//if branch wasn't taken, set hrt lowest index in that branch to 0
@@ -408,6 +515,18 @@ void update_predictor(std::uint64_t pc, branch_dir actual, branch_dir predicted,
 void complete_predictor(branch_stats_t *p_stats) {
 	//correct/branches = prediction rate, so update misprediction rate to 1-prediction rate
 	p_stats->misprediction_rate = 1 - ((double)p_stats->correct / (double)p_stats->num_branches);
+	//instruction counts are only known for traces that carry them, otherwise leave MPKI and density at 0
+	if (p_stats->num_insts > 0) {
+		//mispredictions per 1000 instructions
+		p_stats->mpki = 1000.0 * (double)(p_stats->num_branches - p_stats->correct) / (double)p_stats->num_insts;
+		//fraction of instructions that are branches
+		p_stats->branch_density = (double)p_stats->num_branches / (double)p_stats->num_insts;
+	}
+	//free the tables so the predictor can be set up again for another configuration
+	delete [] pht;
+	delete [] hrt;
+	pht = nullptr;
+	hrt = nullptr;
 	//set global variables back to 0
 	counter_range = 0;
 	history_range = 0;
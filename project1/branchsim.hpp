@@ -10,6 +10,9 @@ struct branch_stats_t {
     std::uint64_t correct;
     double   misprediction_rate;
     std::uint64_t storage_overhead;
+    std::uint64_t num_insts;
+    double   mpki;
+    double   branch_density;
 };
 
 enum predictor_type {
@@ -19,11 +22,20 @@ enum predictor_type {
     PTYPE_TWO_LEVEL_ADAPTIVE = 'T',
 };
 
+enum index_hash {
+    HASH_MULTIPLICATIVE      = 'M',
+    HASH_XOR_FOLD            = 'X',
+    HASH_SKEWED              = 'S',
+    HASH_ADDRESS_BITS        = 'A',
+};
+
 enum branch_dir {
     TAKEN       = 'T',
     NOT_TAKEN   = 'N',
 };
 
+void set_index_hash(index_hash hash);
+std::uint64_t predictor_storage(predictor_type ptype, int num_entries, int counter_bits, int history_bits);
 void setup_predictor(predictor_type ptype, int num_entries, int counter_bits, int history_bits,
                      branch_stats_t* p_stats);
 branch_dir predict_branch(std::uint64_t pc, branch_stats_t* p_stats);
@@ -0,0 +1,295 @@
+#include <cstdio>
+#include <cinttypes>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "branchsim_cache.hpp"
+
+//a trace named in the manifest, loaded by the first job that needs it and freed after its last job
+struct batch_trace_t {
+    std::string path;
+    double weight;
+    std::mutex lock;
+    bool info_known;
+    trace_info_t info;
+    bool loaded;
+    std::vector<branch_record_t> records;
+    std::size_t jobs_left;
+};
+
+//one (trace, configuration) pair and its result
+struct batch_job_t {
+    std::size_t trace;
+    std::size_t config;
+    branch_stats_t stats;
+    bool ok;
+};
+
+void print_help_and_exit() {
+    printf("branchsim_batch [OPTIONS] MANIFEST\n");
+    printf("  -j [THREADS]\tNumber of worker threads (default: all cores)\n");
+    printf("  -C [DIR]\tCache results in DIR and reuse them across runs\n");
+    printf("  -h\t\tThis helpful output\n");
+    printf("\n");
+    printf("Manifest lines ('#' starts a comment):\n");
+    printf("  trace PATH [WEIGHT]\n");
+    printf("  config TYPE ENTRIES COUNTER_BITS HISTORY_BITS [HASH]\n");
+    printf("Every config is run on every trace.\n");
+
+    exit(0);
+}
+
+/**
+ * Checks a manifest configuration the way branchsim_tune builds its candidates: a power-of-two
+ * entry count, gshare indexing exactly its history, and a history for every type that keeps one.
+ * The local history tables are sized and indexed with ints, so they must also fit in one.
+ * setup_predictor would otherwise build a bad index mask, too small a table or no tables at all.
+ */
+bool valid_config(const predictor_config_t& config) {
+    if (config.num_entries <= 0 || (config.num_entries & (config.num_entries - 1)) != 0
+        || config.counter_bits < 1 || config.history_bits < 0 || config.history_bits > 30) {
+        return false;
+    }
+    if (config.ptype == PTYPE_BIMODAL) {
+        return true;
+    }
+    if (config.history_bits == 0) {
+        return false;
+    }
+    std::uint64_t pattern_length = ((std::uint64_t)config.num_entries << config.history_bits) + 1;
+    std::uint64_t history_length = (std::uint64_t)config.num_entries * config.history_bits;
+    if ((config.ptype == PTYPE_LOCAL_HISTORY && pattern_length > INT_MAX)
+        || (config.ptype != PTYPE_GSHARE && history_length > INT_MAX)) {
+        return false;
+    }
+    return config.ptype != PTYPE_GSHARE || config.num_entries == 1 << config.history_bits;
+}
+
+/**
+ * Reads the manifest. Returns false (after printing the offending line) on a malformed line.
+ */
+bool read_manifest(const char* path, std::vector<batch_trace_t>* p_traces, std::vector<predictor_config_t>* p_configs) {
+    std::FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("Could not open %s\n", path);
+        return false;
+    }
+    std::vector<std::pair<std::string, double> > traces;
+    char line[4096];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        char kind[16];
+        char trace_path[4000];
+        char ptype = 0;
+        char hash = HASH_MULTIPLICATIVE;
+        double weight = 1.0;
+        predictor_config_t config;
+        if (sscanf(line, "%15s", kind) != 1) {
+            continue;
+        } else if (strcmp(kind, "trace") == 0 && sscanf(line, "%*s %3999s %lf", trace_path, &weight) >= 1 && weight > 0) {
+            traces.push_back(std::make_pair(std::string(trace_path), weight));
+        } else if (strcmp(kind, "config") == 0
+                   && sscanf(line, "%*s %c %d %d %d %c", &ptype, &config.num_entries, &config.counter_bits,
+                             &config.history_bits, &hash) >= 4
+                   && strchr("BGLT", ptype) != NULL && strchr("MXSA", hash) != NULL) {
+            config.ptype = static_cast<predictor_type>(ptype);
+            config.hash = static_cast<index_hash>(hash);
+            if (!valid_config(config)) {
+                printf("%s:%d: malformed line\n", path, line_number);
+                ok = false;
+                continue;
+            }
+            p_configs->push_back(config);
+        } else {
+            printf("%s:%d: malformed line\n", path, line_number);
+            ok = false;
+        }
+    }
+    fclose(fp);
+
+    //the mutex in each trace cannot be moved, so size the vector once and fill it in place
+    std::vector<batch_trace_t> sized(traces.size());
+    p_traces->swap(sized);
+    for (std::size_t i = 0; i < traces.size(); i++) {
+        (*p_traces)[i].path = traces[i].first;
+        (*p_traces)[i].weight = traces[i].second;
+        (*p_traces)[i].info_known = false;
+        (*p_traces)[i].loaded = false;
+        (*p_traces)[i].jobs_left = 0;
+    }
+    return ok;
+}
+
+/**
+ * Worker loop. Jobs are handed out trace-major, so the workers share each trace while it is
+ * resident and at most one trace per worker is ever held in memory.
+ */
+void batch_worker(std::vector<batch_job_t>* p_jobs, std::vector<batch_trace_t>* p_traces,
+                  const std::vector<predictor_config_t>* p_configs, const char* cache_dir,
+                  std::atomic<std::size_t>* p_next) {
+    std::size_t j;
+    while ((j = p_next->fetch_add(1)) < p_jobs->size()) {
+        batch_job_t& job = (*p_jobs)[j];
+        batch_trace_t& trace = (*p_traces)[job.trace];
+        const predictor_config_t& config = (*p_configs)[job.config];
+
+        std::unique_lock<std::mutex> guard(trace.lock);
+        bool hit = cache_dir != NULL && trace.info_known
+                   && cache_lookup(cache_dir, trace.info, trace.info.num_branches, config, &job.stats);
+        if (!hit && !trace.loaded) {
+            std::FILE* fp = fopen(trace.path.c_str(), "r");
+            if (fp != NULL) {
+                load_trace(fp, &trace.records);
+                fclose(fp);
+            }
+            trace.loaded = true;
+            trace.info.hash = hash_trace(trace.records);
+            trace.info.num_branches = trace.records.size();
+            trace.info_known = true;
+            if (cache_dir != NULL && fp != NULL) {
+                cache_store_trace(cache_dir, trace.path.c_str(), trace.info);
+            }
+        }
+        trace_info_t info = trace.info;
+        guard.unlock();
+
+        job.ok = info.num_branches > 0;
+        if (!hit && job.ok) {
+            //the records are only written while loading, so runs can read them without the lock
+            run_predictor(config, trace.records.data(), trace.records.size(), &job.stats);
+            if (cache_dir != NULL) {
+                cache_store(cache_dir, info, info.num_branches, config, job.stats);
+            }
+        }
+
+        guard.lock();
+        if (--trace.jobs_left == 0) {
+            std::vector<branch_record_t>().swap(trace.records);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    unsigned num_threads = std::thread::hardware_concurrency();
+    const char* cache_dir = NULL;
+
+    // Process arguments
+    while(-1 != (opt = getopt(argc, argv, "j:C:h"))) {
+        switch(opt) {
+        case 'j':
+            num_threads = atoi(optarg);
+            break;
+        case 'C':
+            cache_dir = optarg;
+            break;
+        case 'h':
+            // Fall through
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+    if (optind != argc - 1) {
+        print_help_and_exit();
+    }
+    if (num_threads == 0) {
+        num_threads = 1;
+    }
+
+    std::vector<batch_trace_t> traces;
+    std::vector<predictor_config_t> configs;
+    if (!read_manifest(argv[optind], &traces, &configs)) {
+        return 1;
+    }
+
+    std::vector<batch_job_t> jobs;
+    for (std::size_t t = 0; t < traces.size(); t++) {
+        if (cache_dir != NULL) {
+            traces[t].info_known = cache_lookup_trace(cache_dir, traces[t].path.c_str(), &traces[t].info);
+        }
+        for (std::size_t c = 0; c < configs.size(); c++) {
+            batch_job_t job;
+            memset(&job, 0, sizeof(job));
+            job.trace = t;
+            job.config = c;
+            jobs.push_back(job);
+            traces[t].jobs_left++;
+        }
+    }
+
+    printf("Batch Settings\n");
+    printf("# Traces: %zu\n", traces.size());
+    printf("# Configs: %zu\n", configs.size());
+    printf("# Threads: %u\n", num_threads);
+    printf("\n");
+
+    std::atomic<std::size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < num_threads; i++) {
+        workers.push_back(std::thread(batch_worker, &jobs, &traces, &configs, cache_dir, &next));
+    }
+    for (std::size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    printf("Per-Trace Results\n");
+    printf("Trace Config Branches Insts MispredRate MPKI BranchDensity\n");
+    for (std::size_t j = 0; j < jobs.size(); j++) {
+        const predictor_config_t& c = configs[jobs[j].config];
+        if (!jobs[j].ok) {
+            printf("%s %c:%d:%d:%d:%c - (empty or missing trace)\n", traces[jobs[j].trace].path.c_str(),
+                   static_cast<char>(c.ptype), c.num_entries, c.counter_bits, c.history_bits, static_cast<char>(c.hash));
+            continue;
+        }
+        printf("%s %c:%d:%d:%d:%c %" PRIu64 " %" PRIu64 " %f %f %f\n", traces[jobs[j].trace].path.c_str(),
+               static_cast<char>(c.ptype), c.num_entries, c.counter_bits, c.history_bits, static_cast<char>(c.hash),
+               jobs[j].stats.num_branches, jobs[j].stats.num_insts, jobs[j].stats.misprediction_rate, jobs[j].stats.mpki,
+               jobs[j].stats.branch_density);
+    }
+    printf("\n");
+
+    // Means over the traces that produced a result; a zero rate drives the geometric mean to zero
+    printf("Summary\n");
+    printf("Config Traces GeomeanMispredRate WeightedMispredRate\n");
+    for (std::size_t c = 0; c < configs.size(); c++) {
+        double log_sum = 0.0;
+        bool zero = false;
+        double weighted = 0.0;
+        double weight_sum = 0.0;
+        std::size_t count = 0;
+        for (std::size_t j = c; j < jobs.size(); j += configs.size()) {
+            if (!jobs[j].ok) {
+                continue;
+            }
+            double rate = jobs[j].stats.misprediction_rate;
+            if (rate > 0.0) {
+                log_sum += std::log(rate);
+            } else {
+                zero = true;
+            }
+            weighted += traces[jobs[j].trace].weight * rate;
+            weight_sum += traces[jobs[j].trace].weight;
+            count++;
+        }
+        double geomean = (count == 0 || zero) ? 0.0 : std::exp(log_sum / count);
+        printf("%c:%d:%d:%d:%c %zu %f %f\n", static_cast<char>(configs[c].ptype), configs[c].num_entries,
+               configs[c].counter_bits, configs[c].history_bits, static_cast<char>(configs[c].hash), count, geomean,
+               weight_sum > 0.0 ? weighted / weight_sum : 0.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <cstdio>
+#include <cinttypes>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "branchsim_cache.hpp"
+
+/**
+ * The cache is a flat directory of small text files. Result files are named by a hash of their
+ * key (trace hash, replayed branch count, predictor configuration and code version) and repeat
+ * the full key on their first line so a hash collision reads as a miss. Trace files remember the
+ * hash of a trace file by path, size and modification time so a hit never has to read the trace.
+ */
+
+const static std::uint64_t FNV_OFFSET = 14695981039346656037ULL;
+const static std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+//folds len bytes into a 64-bit FNV-1a hash
+static std::uint64_t fnv1a(std::uint64_t hash, const void* data, std::size_t len) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+//builds the path of a cache entry from its key line
+static std::string entry_path(const char* cache_dir, const char* prefix, const std::string& key) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%s%016" PRIx64, prefix, fnv1a(FNV_OFFSET, key.data(), key.size()));
+    return std::string(cache_dir) + name;
+}
+
+//reads an entry, returning its second line only if the first line matches the key
+static bool read_entry(const std::string& path, const std::string& key, char* value, int value_size) {
+    std::FILE* fp = std::fopen(path.c_str(), "r");
+    if (fp == NULL) {
+        return false;
+    }
+    std::string line(key.size() + 2, '\0');
+    bool hit = std::fgets(&line[0], line.size(), fp) != NULL && std::strncmp(line.c_str(), key.c_str(), key.size()) == 0
+               && line[key.size()] == '\n' && std::fgets(value, value_size, fp) != NULL;
+    std::fclose(fp);
+    return hit;
+}
+
+//writes an entry through a temporary file, unique to this process and thread, so concurrent readers never see a partial entry
+static void write_entry(const char* cache_dir, const std::string& path, const std::string& key, const char* value) {
+    mkdir(cache_dir, 0777);
+    char tmp_suffix[48];
+    std::snprintf(tmp_suffix, sizeof(tmp_suffix), ".tmp%d.%zx", (int)getpid(),
+                  std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::string tmp = path + tmp_suffix;
+
+    std::FILE* fp = std::fopen(tmp.c_str(), "w");
+    if (fp == NULL) {
+        return;
+    }
+    std::fprintf(fp, "%s\n%s\n", key.c_str(), value);
+    if (std::fclose(fp) != 0 || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+    }
+}
+
+//identifies a trace file by where it is and when it last changed
+static bool trace_key(const char* trace_path, std::string* p_key) {
+    struct stat st;
+    if (stat(trace_path, &st) != 0) {
+        return false;
+    }
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), " %" PRIu64 " %" PRIu64 " %" PRId64, (std::uint64_t)st.st_size,
+                  (std::uint64_t)st.st_ino, (std::int64_t)st.st_mtime);
+    *p_key = std::string("trace ") + trace_path + buf;
+    return true;
+}
+
+//identifies a predictor run
+static std::string result_key(const trace_info_t& trace, std::uint64_t num_branches, const predictor_config_t& config) {
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "result v%d %016" PRIx64 " %" PRIu64 " %c %d %d %d %c", BRANCHSIM_CODE_VERSION,
+                  trace.hash, num_branches, static_cast<char>(config.ptype), config.num_entries,
+                  config.counter_bits, config.history_bits, static_cast<char>(config.hash));
+    return buf;
+}
+
+/**
+ * Subroutine that hashes the contents of a trace. Two traces with the same branches hash the same
+ * no matter how they were formatted on disk.
+ *
+ * @param[in]   records     The branch records
+ *
+ * @return                  64-bit content hash
+ */
+std::uint64_t hash_trace(const std::vector<branch_record_t>& records) {
+    std::uint64_t hash = FNV_OFFSET;
+    for (std::size_t i = 0; i < records.size(); i++) {
+        char dir = static_cast<char>(records[i].dir);
+        hash = fnv1a(hash, &records[i].pc, sizeof(records[i].pc));
+        hash = fnv1a(hash, &dir, sizeof(dir));
+        hash = fnv1a(hash, &records[i].num_insts, sizeof(records[i].num_insts));
+    }
+    return hash;
+}
+
+/**
+ * Subroutine that looks up the content hash of a trace file without reading it.
+ *
+ * @param[in]   cache_dir   The cache directory
+ * @param[in]   trace_path  The trace file
+ * @param[out]  p_info      The trace hash and branch count
+ *
+ * @return                  true on a hit
+ */
+bool cache_lookup_trace(const char* cache_dir, const char* trace_path, trace_info_t* p_info) {
+    std::string key;
+    char value[64];
+    if (!trace_key(trace_path, &key) || !read_entry(entry_path(cache_dir, "trace-", key), key, value, sizeof(value))) {
+        return false;
+    }
+    return std::sscanf(value, "%" SCNx64 " %" SCNu64, &p_info->hash, &p_info->num_branches) == 2;
+}
+
+/**
+ * Subroutine that remembers the content hash of a trace file.
+ *
+ * @param[in]   cache_dir   The cache directory
+ * @param[in]   trace_path  The trace file
+ * @param[in]   info        The trace hash and branch count
+ */
+void cache_store_trace(const char* cache_dir, const char* trace_path, const trace_info_t& info) {
+    std::string key;
+    if (!trace_key(trace_path, &key)) {
+        return;
+    }
+    char value[64];
+    std::snprintf(value, sizeof(value), "%016" PRIx64 " %" PRIu64, info.hash, info.num_branches);
+    write_entry(cache_dir, entry_path(cache_dir, "trace-", key), key, value);
+}
+
+/**
+ * Subroutine that looks up the final statistics of a predictor run.
+ *
+ * @param[in]   cache_dir   The cache directory
+ * @param[in]   trace       The trace the run replays
+ * @param[in]   num_branches How many branches of the trace the run replays
+ * @param[in]   config      The predictor configuration
+ * @param[out]  p_stats     Pointer to the stats structure
+ *
+ * @return                  true on a hit
+ */
+bool cache_lookup(const char* cache_dir, const trace_info_t& trace, std::uint64_t num_branches,
+                  const predictor_config_t& config, branch_stats_t* p_stats) {
+    std::string key = result_key(trace, num_branches, config);
+    char value[256];
+    if (!read_entry(entry_path(cache_dir, "", key), key, value, sizeof(value))) {
+        return false;
+    }
+    //the rates are stored as hex floats so a hit is bit-identical to a fresh run
+    return std::sscanf(value, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %la %" SCNu64 " %la %la",
+                       &p_stats->num_branches, &p_stats->pred_taken, &p_stats->pred_not_taken, &p_stats->correct,
+                       &p_stats->storage_overhead, &p_stats->misprediction_rate, &p_stats->num_insts, &p_stats->mpki,
+                       &p_stats->branch_density) == 9;
+}
+
+/**
+ * Subroutine that records the final statistics of a predictor run.
+ *
+ * @param[in]   cache_dir   The cache directory
+ * @param[in]   trace       The trace the run replays
+ * @param[in]   num_branches How many branches of the trace the run replays
+ * @param[in]   config      The predictor configuration
+ * @param[in]   stats       The final statistics
+ */
+void cache_store(const char* cache_dir, const trace_info_t& trace, std::uint64_t num_branches,
+                 const predictor_config_t& config, const branch_stats_t& stats) {
+    char value[256];
+    std::snprintf(value, sizeof(value), "%" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %a %" PRIu64 " %a %a",
+                  stats.num_branches, stats.pred_taken, stats.pred_not_taken, stats.correct, stats.storage_overhead,
+                  stats.misprediction_rate, stats.num_insts, stats.mpki, stats.branch_density);
+    std::string key = result_key(trace, num_branches, config);
+    write_entry(cache_dir, entry_path(cache_dir, "", key), key, value);
+}
@@ -0,0 +1,24 @@
+#ifndef BRANCHSIM_CACHE_HPP
+#define BRANCHSIM_CACHE_HPP
+
+#include <cstdint>
+#include <vector>
+#include "branchsim_run.hpp"
+
+//bump whenever a change to the predictors or the trace format would change cached results
+const static int BRANCHSIM_CODE_VERSION = 2;
+
+struct trace_info_t {
+    std::uint64_t hash;
+    std::uint64_t num_branches;
+};
+
+std::uint64_t hash_trace(const std::vector<branch_record_t>& records);
+bool cache_lookup_trace(const char* cache_dir, const char* trace_path, trace_info_t* p_info);
+void cache_store_trace(const char* cache_dir, const char* trace_path, const trace_info_t& info);
+bool cache_lookup(const char* cache_dir, const trace_info_t& trace, std::uint64_t num_branches,
+                  const predictor_config_t& config, branch_stats_t* p_stats);
+void cache_store(const char* cache_dir, const trace_info_t& trace, std::uint64_t num_branches,
+                 const predictor_config_t& config, const branch_stats_t& stats);
+
+#endif /* BRANCHSIM_CACHE_HPP */
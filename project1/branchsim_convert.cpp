@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <cinttypes>
+#include <cstdlib>
+#include <vector>
+#include <unistd.h>
+#include "branchsim_run.hpp"
+
+void print_help_and_exit() {
+    printf("branchsim_convert [OPTIONS] < traces/file.trace > traces/file.btrace\n");
+    printf("  -t\t\tWrite a text trace instead of a binary one\n");
+    printf("  -h\t\tThis helpful output\n");
+    printf("Reads a text or binary trace and rewrites it in the other (or the same) format.\n");
+
+    exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    bool text = false;
+
+    // Process arguments
+    while(-1 != (opt = getopt(argc, argv, "th"))) {
+        switch(opt) {
+        case 't':
+            text = true;
+            break;
+        case 'h':
+            // Fall through
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    std::vector<branch_record_t> records;
+    if (!load_trace(stdin, &records)) {
+        fprintf(stderr, "Empty or malformed trace\n");
+        return 1;
+    }
+
+    if (text) {
+        for (std::size_t i = 0; i < records.size(); i++) {
+            printf("%" PRIx64 " %c %" PRIu32 "\n", records[i].pc, static_cast<char>(records[i].dir), records[i].num_insts);
+        }
+    } else if (!write_binary_trace(stdout, records)) {
+        fprintf(stderr, "Write failed\n");
+        return 1;
+    }
+    return 0;
+}
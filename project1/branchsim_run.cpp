@@ -0,0 +1,126 @@
+#include <cinttypes>
+#include <cstring>
+#include "branchsim_run.hpp"
+
+/**
+ * Binary traces are BINARY_TRACE_MAGIC followed by 12-byte little-endian records: the 64-bit PC,
+ * then a 32-bit word holding the direction in bit 31 (1 = taken) and the instruction count in the
+ * low 31 bits.
+ */
+const static int BINARY_RECORD_SIZE = 12;
+const static std::uint32_t BINARY_TAKEN_BIT = 0x80000000u;
+
+//reads the records of a binary trace whose magic has already been consumed
+static bool load_binary_trace(std::FILE* fp, std::vector<branch_record_t>* p_records) {
+    unsigned char buf[BINARY_RECORD_SIZE * 4096];
+    std::size_t n;
+    while ((n = std::fread(buf, BINARY_RECORD_SIZE, 4096, fp)) > 0) {
+        for (std::size_t i = 0; i < n; i++) {
+            const unsigned char* b = buf + i * BINARY_RECORD_SIZE;
+            std::uint64_t pc = 0;
+            std::uint32_t word = 0;
+            for (int k = 7; k >= 0; k--) {
+                pc = (pc << 8) | b[k];
+            }
+            for (int k = 11; k >= 8; k--) {
+                word = (word << 8) | b[k];
+            }
+            branch_record_t record;
+            record.pc = pc;
+            record.dir = (word & BINARY_TAKEN_BIT) ? TAKEN : NOT_TAKEN;
+            record.num_insts = word & ~BINARY_TAKEN_BIT;
+            p_records->push_back(record);
+        }
+    }
+    return !p_records->empty();
+}
+
+/**
+ * Subroutine that reads a whole branch trace into memory so it can be replayed against many
+ * predictor configurations. Binary traces are recognized by their magic. Each line of a text
+ * trace is "PC DIR [INSTS]" with the PC in hex, DIR either 'T' or 'N', and the optional INSTS
+ * the number of instructions since the previous branch, including this one.
+ *
+ * @param[in]   fp          The trace file
+ * @param[out]  p_records   The branch records, in trace order
+ *
+ * @return                  true if at least one branch was read
+ */
+bool load_trace(std::FILE* fp, std::vector<branch_record_t>* p_records) {
+    int first = std::getc(fp);
+    if (first == BINARY_TRACE_MAGIC[0]) {
+        char magic[sizeof(BINARY_TRACE_MAGIC) - 1];
+        if (std::fread(magic, 1, sizeof(magic), fp) != sizeof(magic)
+            || std::memcmp(magic, BINARY_TRACE_MAGIC + 1, sizeof(magic)) != 0) {
+            return false;
+        }
+        return load_binary_trace(fp, p_records);
+    }
+    std::ungetc(first, fp);
+
+    char line[256];
+    while (std::fgets(line, sizeof(line), fp) != NULL) {
+        std::uint64_t pc = 0;
+        char dir = 0;
+        std::uint32_t num_insts = 0;
+        if (std::sscanf(line, "%" SCNx64 " %c %" SCNu32, &pc, &dir, &num_insts) >= 2) {
+            branch_record_t record;
+            record.pc = pc;
+            record.dir = (dir == 'T') ? TAKEN : NOT_TAKEN;
+            record.num_insts = num_insts & ~BINARY_TAKEN_BIT;
+            p_records->push_back(record);
+        }
+    }
+    return !p_records->empty();
+}
+
+/**
+ * Subroutine that writes records in the binary trace format.
+ *
+ * @param[in]   fp          The output file
+ * @param[in]   records     The branch records
+ *
+ * @return                  true if everything was written
+ */
+bool write_binary_trace(std::FILE* fp, const std::vector<branch_record_t>& records) {
+    if (std::fwrite(BINARY_TRACE_MAGIC, 1, sizeof(BINARY_TRACE_MAGIC), fp) != sizeof(BINARY_TRACE_MAGIC)) {
+        return false;
+    }
+    for (std::size_t i = 0; i < records.size(); i++) {
+        unsigned char b[BINARY_RECORD_SIZE];
+        std::uint32_t word = (records[i].num_insts & ~BINARY_TAKEN_BIT) | (records[i].dir == TAKEN ? BINARY_TAKEN_BIT : 0);
+        for (int k = 0; k < 8; k++) {
+            b[k] = (unsigned char)(records[i].pc >> (8 * k));
+        }
+        for (int k = 0; k < 4; k++) {
+            b[8 + k] = (unsigned char)(word >> (8 * k));
+        }
+        if (std::fwrite(b, 1, sizeof(b), fp) != sizeof(b)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Subroutine that replays the first count branches of a trace against one predictor configuration
+ * and fills in the final statistics.
+ *
+ * @param[in]   config      The predictor configuration
+ * @param[in]   records     The branch records
+ * @param[in]   count       The number of records to replay
+ * @param[out]  p_stats     Pointer to the stats structure
+ */
+void run_predictor(const predictor_config_t& config, const branch_record_t* records, std::size_t count,
+                   branch_stats_t* p_stats) {
+    std::memset(p_stats, 0, sizeof(branch_stats_t));
+    set_index_hash(config.hash);
+    setup_predictor(config.ptype, config.num_entries, config.counter_bits, config.history_bits, p_stats);
+
+    for (std::size_t i = 0; i < count; i++) {
+        branch_dir predicted = predict_branch(records[i].pc, p_stats);
+        update_predictor(records[i].pc, records[i].dir, predicted, p_stats);
+        p_stats->num_insts += records[i].num_insts;
+    }
+    complete_predictor(p_stats);
+}
@@ -0,0 +1,31 @@
+#ifndef BRANCHSIM_RUN_HPP
+#define BRANCHSIM_RUN_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "branchsim.hpp"
+
+//first bytes of a binary trace; a text trace can never start with 0x7f
+const static char BINARY_TRACE_MAGIC[8] = {'\x7f', 'B', 'R', 'T', 1, 0, 0, 0};
+
+struct branch_record_t {
+    std::uint64_t pc;
+    branch_dir    dir;
+    std::uint32_t num_insts; //instructions since the previous branch, including this one (0 if unknown)
+};
+
+struct predictor_config_t {
+    predictor_type ptype;
+    int num_entries;
+    int counter_bits;
+    int history_bits;
+    index_hash hash;
+};
+
+bool load_trace(std::FILE* fp, std::vector<branch_record_t>* p_records);
+bool write_binary_trace(std::FILE* fp, const std::vector<branch_record_t>& records);
+void run_predictor(const predictor_config_t& config, const branch_record_t* records, std::size_t count,
+                   branch_stats_t* p_stats);
+
+#endif /* BRANCHSIM_RUN_HPP */
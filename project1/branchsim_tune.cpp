@@ -0,0 +1,286 @@
+#include <cstdio>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <unistd.h>
+#include "branchsim_cache.hpp"
+
+//a configuration being considered by the tuner along with its latest misprediction rate
+struct candidate_t {
+    predictor_config_t config;
+    std::uint64_t storage;
+    double rate;
+};
+
+//the trace being tuned against, loaded only once a run misses the cache
+struct tune_trace_t {
+    std::FILE* fp;
+    const char* cache_dir;
+    trace_info_t info;
+    std::vector<branch_record_t> records;
+    bool loaded;
+};
+
+void print_help_and_exit() {
+    printf("branchsim_tune [OPTIONS] < traces/file.trace\n");
+    printf("  -b [BITS]\tStorage budget in bits (required)\n");
+    printf("  -o [TYPES]\tPredictor types to search, any of BGLT (default BGLT)\n");
+    printf("  -c [BITS]\tLargest counter size to search (default 4)\n");
+    printf("  -H [BITS]\tLargest history size to search (default 16)\n");
+    printf("  -x [HASHES]\tIndex hashes to search for L and T, any of MXSA (default M)\n");
+    printf("  -s [NUM]\tBranches in the shortest sampled prefix (default 10000)\n");
+    printf("  -t [RATE]\tMisprediction rate slack for pruning on the first prefix (default 0.02)\n");
+    printf("  -f [FILE]\tRead the trace from FILE instead of stdin\n");
+    printf("  -C [DIR]\tCache results in DIR and reuse them across runs\n");
+    printf("  -h\t\tThis helpful output\n");
+
+    exit(0);
+}
+
+/**
+ * Enumerates every configuration of the requested predictor types that fits in the budget.
+ * Gshare is only valid when num_entries == 2^history_bits, and bimodal ignores history_bits.
+ * Only the local and two level predictors index through the pluggable hashes.
+ */
+std::vector<candidate_t> enumerate_candidates(const char* types, const char* hashes, std::uint64_t budget,
+                                              int max_counter_bits, int max_history_bits) {
+    std::vector<candidate_t> candidates;
+
+    for (const char* t = types; *t; t++) {
+        predictor_type ptype = static_cast<predictor_type>(*t);
+        const char* type_hashes = (ptype == PTYPE_LOCAL_HISTORY || ptype == PTYPE_TWO_LEVEL_ADAPTIVE) ? hashes : "M";
+        for (int log_entries = 0; log_entries < 31; log_entries++) {
+            int num_entries = 1 << log_entries;
+            //every type needs at least one bit per entry, so nothing larger can fit
+            if ((std::uint64_t)num_entries > budget) {
+                break;
+            }
+            for (int counter_bits = 1; counter_bits <= max_counter_bits; counter_bits++) {
+                int min_history = 1;
+                int max_history = max_history_bits;
+                if (ptype == PTYPE_BIMODAL) {
+                    min_history = max_history = 0;
+                } else if (ptype == PTYPE_GSHARE) {
+                    //a zero-bit history would make gshare a single counter
+                    min_history = std::max(log_entries, 1);
+                    max_history = std::min(log_entries, max_history_bits);
+                }
+                for (int history_bits = min_history; history_bits <= max_history; history_bits++) {
+                    std::uint64_t storage = predictor_storage(ptype, num_entries, counter_bits, history_bits);
+                    if (storage > budget) {
+                        continue;
+                    }
+                    for (const char* h = type_hashes; *h; h++) {
+                        candidate_t c;
+                        c.config.ptype = ptype;
+                        c.config.num_entries = num_entries;
+                        c.config.counter_bits = counter_bits;
+                        c.config.history_bits = history_bits;
+                        c.config.hash = static_cast<index_hash>(*h);
+                        c.storage = storage;
+                        c.rate = 0.0;
+                        candidates.push_back(c);
+                    }
+                }
+            }
+        }
+    }
+    return candidates;
+}
+
+bool by_storage_then_rate(const candidate_t& a, const candidate_t& b) {
+    if (a.storage != b.storage) {
+        return a.storage < b.storage;
+    }
+    return a.rate < b.rate;
+}
+
+/**
+ * Drops every candidate that some candidate of no greater storage beats by more than slack.
+ * With a slack of zero and strict comparison this leaves exactly the Pareto frontier.
+ */
+std::vector<candidate_t> prune_dominated(std::vector<candidate_t> candidates, double slack) {
+    std::sort(candidates.begin(), candidates.end(), by_storage_then_rate);
+
+    std::vector<candidate_t> survivors;
+    double best = 2.0;
+    std::size_t i = 0;
+    while (i < candidates.size()) {
+        //candidates with equal storage dominate each other, so fold the whole group in first
+        std::size_t group_end = i;
+        while (group_end < candidates.size() && candidates[group_end].storage == candidates[i].storage) {
+            best = std::min(best, candidates[group_end].rate);
+            group_end++;
+        }
+        for (; i < group_end; i++) {
+            if (candidates[i].rate <= best + slack) {
+                survivors.push_back(candidates[i]);
+            }
+        }
+    }
+    return survivors;
+}
+
+/**
+ * Runs one candidate on the first num_branches branches of the trace and returns its misprediction
+ * rate, answering from the result cache when it can.
+ */
+double evaluate(const candidate_t& c, std::size_t num_branches, tune_trace_t* p_trace) {
+    branch_stats_t stats;
+    if (p_trace->cache_dir != NULL && cache_lookup(p_trace->cache_dir, p_trace->info, num_branches, c.config, &stats)) {
+        return stats.misprediction_rate;
+    }
+    if (!p_trace->loaded) {
+        load_trace(p_trace->fp, &p_trace->records);
+        p_trace->loaded = true;
+    }
+    run_predictor(c.config, p_trace->records.data(), num_branches, &stats);
+    if (p_trace->cache_dir != NULL) {
+        cache_store(p_trace->cache_dir, p_trace->info, num_branches, c.config, stats);
+    }
+    return stats.misprediction_rate;
+}
+
+/**
+ * Keeps only candidates that strictly improve on every smaller configuration.
+ */
+std::vector<candidate_t> pareto_frontier(std::vector<candidate_t> candidates) {
+    std::sort(candidates.begin(), candidates.end(), by_storage_then_rate);
+
+    std::vector<candidate_t> frontier;
+    double best = 2.0;
+    for (std::size_t i = 0; i < candidates.size(); i++) {
+        if (candidates[i].rate < best) {
+            frontier.push_back(candidates[i]);
+            best = candidates[i].rate;
+        }
+    }
+    return frontier;
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    std::uint64_t budget = 0;
+    const char* types = "BGLT";
+    const char* hashes = "M";
+    int max_counter_bits = 4;
+    int max_history_bits = 16;
+    std::size_t min_sample = 10000;
+    double slack = 0.02;
+    const char* trace_path = NULL;
+    const char* cache_dir = NULL;
+
+    // Process arguments
+    while(-1 != (opt = getopt(argc, argv, "b:o:c:H:x:s:t:f:C:h"))) {
+        switch(opt) {
+        case 'b':
+            budget = strtoull(optarg, NULL, 10);
+            break;
+        case 'o':
+            types = optarg;
+            break;
+        case 'c':
+            max_counter_bits = atoi(optarg);
+            break;
+        case 'H':
+            max_history_bits = atoi(optarg);
+            break;
+        case 'x':
+            hashes = optarg;
+            break;
+        case 's':
+            min_sample = strtoull(optarg, NULL, 10);
+            break;
+        case 't':
+            slack = atof(optarg);
+            break;
+        case 'f':
+            trace_path = optarg;
+            break;
+        case 'C':
+            cache_dir = optarg;
+            break;
+        case 'h':
+            // Fall through
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+    if (budget == 0 || strspn(types, "BGLT") != strlen(types)
+        || *hashes == '\0' || strspn(hashes, "MXSA") != strlen(hashes)) {
+        print_help_and_exit();
+    }
+
+    tune_trace_t trace;
+    trace.fp = stdin;
+    trace.cache_dir = cache_dir;
+    trace.loaded = false;
+    if (trace_path != NULL && (trace.fp = fopen(trace_path, "r")) == NULL) {
+        printf("Could not open %s\n", trace_path);
+        return 1;
+    }
+    // A named trace that has been seen before is identified without reading it
+    if (cache_dir == NULL || trace_path == NULL || !cache_lookup_trace(cache_dir, trace_path, &trace.info)) {
+        load_trace(trace.fp, &trace.records);
+        trace.loaded = true;
+        trace.info.hash = hash_trace(trace.records);
+        trace.info.num_branches = trace.records.size();
+        if (cache_dir != NULL && trace_path != NULL) {
+            cache_store_trace(cache_dir, trace_path, trace.info);
+        }
+    }
+    std::size_t num_branches = trace.info.num_branches;
+    if (num_branches == 0) {
+        printf("Empty trace\n");
+        return 1;
+    }
+
+    std::vector<candidate_t> candidates = enumerate_candidates(types, hashes, budget, max_counter_bits, max_history_bits);
+
+    printf("Tuner Settings\n");
+    printf("Budget: %" PRIu64 " bits\n", budget);
+    printf("Predictor Types: %s\n", types);
+    printf("Index Hashes: %s\n", hashes);
+    printf("# Branches: %zu\n", num_branches);
+    printf("# Candidates: %zu\n", candidates.size());
+    printf("\n");
+
+    // Build the prefix schedule, quartering from the full trace down to the shortest sample
+    std::vector<std::size_t> prefixes;
+    for (std::size_t len = num_branches / 4; len >= min_sample && len > 0; len /= 4) {
+        prefixes.insert(prefixes.begin(), len);
+    }
+
+    // Prune on each prefix, tightening the slack as the prefixes become more representative
+    for (std::size_t stage = 0; stage < prefixes.size(); stage++) {
+        for (std::size_t i = 0; i < candidates.size(); i++) {
+            candidates[i].rate = evaluate(candidates[i], prefixes[stage], &trace);
+        }
+        std::size_t before = candidates.size();
+        candidates = prune_dominated(candidates, slack);
+        printf("Stage %zu: %zu branches, %zu -> %zu candidates\n", stage + 1, prefixes[stage], before,
+               candidates.size());
+        slack /= 2;
+    }
+
+    // Only the survivors see the full trace
+    for (std::size_t i = 0; i < candidates.size(); i++) {
+        candidates[i].rate = evaluate(candidates[i], num_branches, &trace);
+    }
+    printf("Final: %zu branches, %zu candidates\n", num_branches, candidates.size());
+    printf("\n");
+
+    std::vector<candidate_t> frontier = pareto_frontier(candidates);
+    printf("Pareto Frontier\n");
+    printf("Type Entries CounterBits HistoryBits Hash Storage MispredRate\n");
+    for (std::size_t i = 0; i < frontier.size(); i++) {
+        const predictor_config_t& c = frontier[i].config;
+        printf("%c %d %d %d %c %" PRIu64 " %f\n", static_cast<char>(c.ptype), c.num_entries, c.counter_bits,
+               c.history_bits, static_cast<char>(c.hash), frontier[i].storage, frontier[i].rate);
+    }
+
+    return 0;
+}
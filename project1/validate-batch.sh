@@ -0,0 +1,25 @@
+#!/bin/sh
+binary="./branchsim_batch"
+
+validate_manifest() {
+    binary=$1
+    manifest_name=$2
+
+    ${binary} -j 1 test-manifests/${manifest_name}.manifest > myoutput/${manifest_name}.out
+    echo "exit $?" >> myoutput/${manifest_name}.out
+    diff test-output/${manifest_name}.out myoutput/${manifest_name}.out
+}
+
+if [ ! -f "${binary}" ]
+then
+    echo "Executable ${binary}" not found
+    exit 1
+fi
+
+rm -rf myoutput
+mkdir myoutput
+
+for manifest_name in "small" "large-local"
+do
+    validate_manifest "${binary}" "$manifest_name"
+done
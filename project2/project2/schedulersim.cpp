@@ -1,143 +1,355 @@
 #include "schedulersim.hpp"
+#include "schedulersim_pipeview.hpp"
+#include "schedulersim_latency.hpp"
 #include <cstdio>
+#include <cstdint>
 #include <vector>
+#include <utility>
+#include <algorithm>
 using namespace std;
 
-//tracks the current cycle the scheduler is on
-int current_cycle = 1;
-
-//struct tracking important values to each instruction scheduled
-struct instruction {
-    op_type opcode; //type of instruction
-    int destination; //destination register of instruction
-    int src1; //register 1 of instruction
-    int src2; //register 2 of instruction
-    int cyclesLeft; //how many cycles the instruction has left to operate
-    int cycleIssued; //what cycle the instruction was issued
-    bool active; //was the instruction fired
-};
-
-//struct tracking individual reservation stations for perFU implementation
-struct rStation {
-    int maxAddSize; //max possible size of add reservation station
-    int currAddSize; //current size of add reservation station
-    int maxDivSize; //max possible size of div reservation station
-    int currDivSize; //current size of div reservation station
-    int maxMemSize; //max possible size of mem reservation station
-    int currMemSize; //current size of mem reservation station
-    instruction *addRS; //add reservation station pointer
-    instruction *divRS; //div reservation station pointer
-    instruction *memRS; //mem reservation station pointer
-};
-
-//reservation station array for unified
-instruction *resStation;
-//max reservation station size for unified
-int maxResSize;
-//current reservation station size for unified
-int currResSize = 0;
-
-//instance of rStation for perFU
-rStation instance;
-//pointer to instance of rStation perFU
-rStation *rs = &instance;
-
-//register alias table pointer
-int *rat;
-//type of scheduler (0 for unified, 1 for perFU)
-int rsType = -1;
-//current size of how many instructions are being fired perFU
-int currPipelineSize = 0;
-//tracks how many instructions are fired per cycle for perFU
-int numFired_FU = 0;
-
-/**
- * Subroutine that returns how long it takes to complete a specific operation type
- *
- * @return                      Instruction latency in cycles
- */
-int get_inst_latency(op_type op) {
-    if(op == OP_ADD) {
-        return 2;
-    } else if(op == OP_DIV) {
-        return 15;
-    } else if(op == OP_MEM) {
-        return 20;
+//the scheduler driven by the scheduler_* functions on this thread
+thread_local Scheduler *instance = NULL;
+//options used by the next scheduler_*_init on this thread (NULL for the defaults)
+thread_local const scheduler_options_t *instanceOptions = NULL;
+//issue order of the writer of a register nothing has written yet
+const uint64_t NO_PRODUCER = ~(uint64_t)0;
+
+/**
+ * XXX: You are welcome to define and set any global classes and variables as needed.
+ */
+
+//bitmap helpers, one bit per entry of the entry pool
+inline bool testBit(const vector<uint64_t> &bits, int e) {
+  return (bits[e >> 6] >> (e & 63)) & 1;
+}
+inline void setBit(vector<uint64_t> &bits, int e) {
+  bits[e >> 6] |= (uint64_t)1 << (e & 63);
+}
+inline void clearBit(vector<uint64_t> &bits, int e) {
+  bits[e >> 6] &= ~((uint64_t)1 << (e & 63));
+}
+
+/**
+ * Helper function that returns the RAT index of one of an instruction's registers, or -1 if the
+ * operand is unused or repeats an earlier operand (so each register is only counted once)
+ *
+ * @param  inst       instruction
+ * @param  operand    0 for the destination, 1 and 2 for the sources
+ */
+int Scheduler::operandReg(const instruction &inst, int operand) {
+  if (operand == 0) {
+    return inst.destination - 1;
+  } else if (operand == 1) {
+    return (inst.src1 == INVALID_REG || inst.src1 == inst.destination) ? -1 : inst.src1 - 1;
+  }
+  return (inst.src2 == INVALID_REG || inst.src2 == inst.destination || inst.src2 == inst.src1) ? -1 : inst.src2 - 1;
+}
+
+/**
+ * Helper function that returns the register an unfired instruction waits on for one operand, or -1.
+ * Without renaming this is its RAT index; with renaming only the physical registers of its
+ * sources are waited on, each once
+ *
+ * @param  inst       instruction
+ * @param  operand    0 for the destination, 1 and 2 for the sources
+ */
+int Scheduler::waitReg(const instruction &inst, int operand) const {
+  if (!renaming) {
+    return operandReg(inst, operand);
+  }
+  if (operand == 1) {
+    return inst.physSrc1;
+  } else if (operand == 2) {
+    return (inst.physSrc2 == inst.physSrc1) ? -1 : inst.physSrc2;
+  }
+  return -1;
+}
+
+/**
+ * Helper function that returns the register one of an instruction's sources is read from, or -1 if
+ * it is unused: its RAT index, or its physical register when renaming. Unlike waitReg this keeps a
+ * source that is also the destination, which is still a true dependency
+ *
+ * @param  inst       instruction
+ * @param  operand    1 or 2
+ */
+int Scheduler::sourceReg(const instruction &inst, int operand) const {
+  if (renaming) {
+    return (operand == 1) ? inst.physSrc1 : inst.physSrc2;
+  }
+  int src = (operand == 1) ? inst.src1 : inst.src2;
+  return (src == INVALID_REG) ? -1 : src - 1;
+}
+
+/**
+ * Helper function that returns the thread whose unfired queue has the oldest head, or -1
+ *
+ * @param  ready      only consider heads waiting on nothing, with their sources through the bypass
+ * @param  unit       only consider heads with a free unit
+ */
+int Scheduler::oldestUnfired(bool ready, bool unit) const {
+  int best = -1;
+  for (int t = 0; t < numThreads; t++) {
+    int e = unfiredHead[t];
+    if (e == -1 || (ready && !(testBit(readyBits, e) && readyCycles[e] <= current_cycle)) ||
+        (unit && !unitAvailable(entries[e].opcode, entries[e].station))) {
+      continue;
     }
-    std::printf("Invalid OP type:%d\n", op);
-    std::exit(1);
+    if (best == -1 || entries[e].issueOrder < entries[unfiredHead[best]].issueOrder) {
+      best = t;
+    }
+  }
+  return best;
 }
 
 /**
- * XXX: You are welcome to define and set any global classes and variables as needed.
+ * Helper function that checks whether the head of some thread's unfired queue waits on nothing,
+ * so it may fire before anything completes
  */
+bool Scheduler::headReady() const {
+  for (int t = 0; t < numThreads; t++) {
+    if (unfiredHead[t] != -1 && testBit(readyBits, unfiredHead[t])) {
+      return true;
+    }
+  }
+  return false;
+}
 
 /**
- * Subroutine for initializing the scheduler (unified reservation station type).
- * You may initalize any global or heap variables as needed.
- * XXX You're responsible for completing this routine.
+ * Helper function that checks whether a register returned by waitReg holds back its readers:
+ * busy in the RAT, or (renaming) a physical register whose value has not been produced yet
+ *
+ * @param  r          register from waitReg
+ */
+bool Scheduler::regBusy(int r) const {
+  return renaming ? !physReady[r] : rat[r] != 0;
+}
+
+/**
+ * Helper function that puts a physical register back on the free list once nothing can use it
+ * again: a younger mapping has replaced it, its value has been produced and every instruction
+ * reading it has fired
+ *
+ * @param  p          physical register
+ */
+void Scheduler::releasePhys(int p) {
+  if (physSuperseded[p] && physReady[p] && physReaders[p] == 0) {
+    physSuperseded[p] = 0;
+    freePhys.push_back(p);
+  }
+}
+
+/**
+ * Helper function that marks an unfired instruction ready to fire
+ *
+ * @param  e          entry of the instruction
+ */
+void Scheduler::markReady(int e) {
+  setBit(readyBits, e);
+  if (renaming) {
+    readyQueue.push(make_pair(entries[e].issueOrder, e));
+    //it could have fired the cycle after it was issued
+    int waited = current_cycle - (entries[e].cycleIssued + 1);
+    if (waited > 0) {
+      rawWaitCycles += waited;
+    }
+  }
+}
+
+/**
+ * Subroutine that fills in the default scheduler options: the default FU classes, no renaming and
+ * no reorder buffer
+ *
+ * @param[out]  p_options       The scheduler options
+ */
+void scheduler_options_default(scheduler_options_t* p_options) {
+  p_options->fu_config = NULL;
+  p_options->num_physical_regs = 0;
+  p_options->rob_size = 0;
+  p_options->commit_width = 0;
+  p_options->pipe_view = NULL;
+  p_options->num_threads = 1;
+  p_options->cdb_width = 0;
+  p_options->bypass_latency = 0;
+  p_options->num_clusters = 1;
+  p_options->steering = STEER_DEPENDENCE;
+  p_options->cluster_delay = 1;
+}
+
+/**
+ * Helper function that sets up the RAT, the wakeup lists and the entry pool for a set of
+ * reservation stations, with every slot on its reservation station's free list
+ *
+ * @param  num_registers    The number of registers in the instructions
+ * @param  sizes            number of slots of each reservation station
+ * @param  count            number of reservation stations
+ * @param  p_options        FU classes, renaming and reorder buffer (NULL for the defaults)
+ */
+void Scheduler::init(int num_registers, const int sizes[], int count, const scheduler_options_t* p_options) {
+  scheduler_options_t options;
+  if (p_options != NULL) {
+    options = *p_options;
+  } else {
+    scheduler_options_default(&options);
+  }
+  if (options.fu_config != NULL) {
+    config = *options.fu_config;
+  } else {
+    fu_config_default(&config);
+  }
+  //each class gets its own stream of draws, so adding a model to one class leaves the others alone
+  for (int op = 0; op < config.num_classes; op++) {
+    latencyModels[op].reset(LatencyModel::create(config.classes[op], config.seed * 0x9e3779b97f4a7c15ULL + op));
+  }
+  current_cycle = 1;
+  if (options.num_threads < 1 || options.num_threads > MAX_SMT_THREADS) {
+    std::printf("Invalid thread count:%d\n", options.num_threads);
+    std::exit(1);
+  }
+  //every thread has its own copy of the registers
+  numThreads = options.num_threads;
+  numRegisters = num_registers;
+  num_registers *= numThreads;
+  for (int t = 0; t < MAX_SMT_THREADS; t++) {
+    unfiredHead[t] = -1;
+    unfiredTail[t] = -1;
+    unfiredPerThread[t] = 0;
+  }
+  currPipelineSize = 0;
+  numUnfired = 0;
+  numIssued = 0;
+  for (int op = 0; op < MAX_FU_CLASSES; op++) {
+    numActive[op] = 0;
+  }
+  if (options.num_clusters < 1 || options.num_clusters > MAX_CLUSTERS) {
+    std::printf("Invalid cluster count:%d\n", options.num_clusters);
+    std::exit(1);
+  }
+  numClusters = options.num_clusters;
+  steering = options.steering;
+  clusterDelay = options.cluster_delay;
+  nextCluster = 0;
+  crossClusterWakeups = 0;
+  for (int k = 0; k < MAX_CLUSTERS; k++) {
+    for (int op = 0; op < MAX_FU_CLASSES; op++) {
+      clusterActive[k][op] = 0;
+      clusterFired[k][op] = 0;
+    }
+  }
+  //register allocation table to size of how many registers there are, nothing busy
+  rat.assign(num_registers, 0);
+  waitHead.assign(num_registers, -1);
+  lastStall = STALL_RS_FULL;
+  unitBlocked = false;
+  rawWaitCycles = 0;
+  robSize = options.rob_size;
+  commitWidth = options.commit_width;
+  pipeView = options.pipe_view;
+  cdbWidth = options.cdb_width;
+  bypassLatency = options.bypass_latency;
+  robHead = 0;
+  robCount = 0;
+  rob.assign(robSize, robEntry());
+  renaming = options.num_physical_regs != 0;
+  if (renaming) {
+    if (options.num_physical_regs <= num_registers) {
+      std::printf("Need more physical registers than the %d architectural ones\n", num_registers);
+      std::exit(1);
+    }
+    //each architectural register starts out mapped to the physical register of the same index,
+    //holding its value, and the rest are free
+    int p = options.num_physical_regs;
+    renameMap.resize(num_registers);
+    for (int r = 0; r < num_registers; r++) {
+      renameMap[r] = r;
+    }
+    physReady.assign(p, 1);
+    physSuperseded.assign(p, 0);
+    physReaders.assign(p, 0);
+    freePhys.clear();
+    for (int r = p - 1; r >= num_registers; r--) {
+      freePhys.push_back(r);
+    }
+    waitHead.assign(p, -1);
+  }
+  producerCluster.assign(waitHead.size(), -1);
+  producerOrder.assign(waitHead.size(), NO_PRODUCER);
+
+  //lay the reservation stations out back to back in the entry pool, each on a word boundary
+  int total = 0;
+  for (int s = 0; s < count; s++) {
+    stations[s].maxSize = sizes[s];
+    stations[s].currSize = 0;
+    stations[s].base = total;
+    stations[s].numWords = (sizes[s] + 63) / 64;
+    stations[s].freeWord = 0;
+    total += stations[s].numWords * 64;
+  }
+  numStations = count;
+  entries.resize(total);
+  waitCounts.resize(total);
+  clearKeys.resize(total);
+  readyCycles.resize(total);
+  sourceProducers.resize(total * 2);
+  nextUnfired.resize(total);
+  waitNext.resize(total * 3);
+  waitPrev.resize(total * 3);
+  occupiedBits.assign(total / 64, 0);
+  readyBits.assign(total / 64, 0);
+  //padding past the end of each reservation station is permanently occupied, so it is never picked
+  for (int s = 0; s < count; s++) {
+    for (int e = stations[s].base + stations[s].maxSize; e < stations[s].base + stations[s].numWords * 64; e++) {
+      setBit(occupiedBits, e);
+    }
+  }
+}
+
+/**
+ * Constructs a scheduler with a unified reservation station
  *
  * @param[in]   num_registers   The number of registers in the instructions
  * @param[in]   rs_size         The number of entries for the unified RS
+ * @param[in]   p_options       Scheduler options (NULL for the defaults)
  */
-void scheduler_unified_init(int num_registers, int rs_size) {
-  //register allocation table to size of how many registers there are
-  rat = new int [num_registers];
-  //clear out garbage memory values that could be in RAT
-  for (int i = 0; i < num_registers; i++) {
-  	rat[i] = 0;
+Scheduler::Scheduler(int num_registers, int rs_size, const scheduler_options_t* p_options) {
+  //one reservation station of rs_size shared by every op type, or one per cluster
+  int clusters = (p_options != NULL) ? min(max(p_options->num_clusters, 1), MAX_CLUSTERS) : 1;
+  int sizes[MAX_CLUSTERS];
+  fill(sizes, sizes + clusters, rs_size);
+  init(num_registers, sizes, clusters, p_options);
+  for (int op = 0; op < MAX_FU_CLASSES; op++) {
+    stationOf[op] = 0;
+    clusterOf[op] = (op < clusters) ? op : 0;
   }
-  //set max reservation station size to rs_size
-  maxResSize = rs_size;
-  //initialize an array of instructions of rs_size
-  resStation = new instruction [rs_size];
-  //set rsType to unified
-  rsType = 0;
 }
 
 /**
- * Subroutine for initializing the scheduler (per-functional unit reservation station type).
- * You may initalize any global or heap variables as needed.
- * XXX You're responsible for completing this routine.
+ * Constructs a scheduler with per-functional unit reservation stations
  *
  * @param[in]   num_registers   The number of registers in the instructions
- * @param[in]   rs_sizes        An array of size 3 that contains the number of entries for each
- *                              op_type
- *                              rs_sizes = [4,2,1] means 4 ADD RS, 2 DIV RS, 1 MEM RS
+ * @param[in]   rs_sizes        The number of entries for each FU class
+ * @param[in]   p_options       Scheduler options (NULL for the defaults)
  */
-void scheduler_per_fu_init(int num_registers, int rs_sizes[]) {
-  //set add reservation max size to the first value in rs_sizes array
-  rs->maxAddSize = rs_sizes[0];
-  //set current add reservation size to 0
-  rs->currAddSize = 0;
-  //initialize add reservation station to array of instructions of size rs_sizes[0]
-  rs->addRS = new instruction [rs_sizes[0]];
-
-  //set div reservation max size to the second value in rs_sizes array
-  rs->maxDivSize = rs_sizes[1];
-  //set current div reservation size to 0
-  rs->currDivSize = 0;
-  //initialize div reservation station to array of instructions of size rs_sizes[1]
-  rs->divRS = new instruction [rs_sizes[1]];
-
-  //set mem reservation max size to the third value in rs_sizes array
-  rs->maxMemSize = rs_sizes[2];
-  //set current mem reservation size to 0
-  rs->currMemSize = 0;
-  //initialize mem reservation station to array of instructions of size rs_sizes[2]
-  rs->memRS = new instruction [rs_sizes[2]];
-
-  //register allocation table to size of how many registers there are
-  rat = new int [num_registers];
-  //clear out possible garbage values in RAT
-  for (int i = 0; i < num_registers; i++) {
-    rat[i] = 0;
-  }
-  rsType = 1;
-}
-
-/**
- * Subroutine that tries to issue an instruction to the reservation station. You need to 
+Scheduler::Scheduler(int num_registers, const int rs_sizes[], const scheduler_options_t* p_options) {
+  //one reservation station per FU class, sized from rs_sizes
+  if (p_options != NULL && p_options->num_clusters > 1) {
+    std::printf("Clusters split a unified reservation station\n");
+    std::exit(1);
+  }
+  bool configured = p_options != NULL && p_options->fu_config != NULL;
+  init(num_registers, rs_sizes, configured ? p_options->fu_config->num_classes : NUM_OPS, p_options);
+  for (int op = 0; op < MAX_FU_CLASSES; op++) {
+    stationOf[op] = op;
+    clusterOf[op] = 0;
+  }
+}
+
+Scheduler::~Scheduler() {
+}
+
+/**
+ * Subroutine that tries to issue an instruction to the reservation station. You need to
  * choose the appropriate RS depending on the RS type and op_type and update the RAT.
  * XXX You're responsible for completing this routine.
  *
@@ -149,89 +361,172 @@ void scheduler_per_fu_init(int num_registers, int rs_sizes[]) {
  *
  * @return                      true if successful, false if we failed
  */
-bool scheduler_try_issue(op_type op, int dest, int src1, int src2, scheduler_stats_t* p_stats) {
-  //if unified
-  if (rsType == 0) {
-    //if we have space in reservation station
-    if (currResSize < maxResSize) {
-      //get the number of cycles this instruction will run for
-      int c = get_inst_latency(op);
-      //add instruction to reservation station
-      resStation[currResSize] = {op, dest, src1, src2, c, current_cycle, false};
-      //increase number of instructions
-      p_stats->num_insts++;
-      //add one to current size of reservation station
-      currResSize++;
-      //successfully scheduled
-      return true;
-    } else {
-      //no space, add a stall
-      p_stats->issue_stall++;
-      return false;
-    }
-  //if perFU
-  } else if (rsType == 1) {
-    //if add instruction
-    if (op == 0) {
-      //if space in add reservation station
-      if (rs->currAddSize < rs->maxAddSize) {
-        //get the number of cycles this instruction will run for
-        int c = get_inst_latency(op);
-        //add instruction to add reservation station
-        rs->addRS[rs->currAddSize] = {op, dest, src1, src2, c, current_cycle, false};
-        //increase num instructions, current add reservation size and current pipeline size
-        p_stats->num_insts++;
-        rs->currAddSize++;
-        currPipelineSize++;
-        //succesfully scheduled
-        return true;
-      } else {
-        //no space, increase stall counter
-        p_stats->issue_stall++;
-        return false;
-      }
-    //if div instruction
-    } else if (op == 1) {
-      //if space in div reservation station
-      if (rs->currDivSize < rs->maxDivSize) {
-        //get the number of cycles this instruction will run for
-        int c = get_inst_latency(op);
-        //add instruction to div reservation station
-        rs->divRS[rs->currDivSize] = {op, dest, src1, src2, c, current_cycle, false};
-        //increase num instructions, current div reservation size and current pipeline size
-        p_stats->num_insts++;
-        rs->currDivSize++;
-        currPipelineSize++;
-        //succesfully scheduled
-        return true;
-      } else {
-        //no space, increase stall counter
-        p_stats->issue_stall++;
-        return false;
+bool Scheduler::try_issue(op_type op, int dest, int src1, int src2, scheduler_stats_t* p_stats, int thread) {
+  //get the number of cycles this instruction will run for
+  if (op < 0 || op >= config.num_classes) {
+    std::printf("Invalid OP type:%d\n", op);
+    std::exit(1);
+  }
+  int c = config.classes[op].latency;
+  //move the registers into the thread's copy of them
+  int base = thread * numRegisters;
+  dest += base;
+  src1 = (src1 == INVALID_REG) ? INVALID_REG : src1 + base;
+  src2 = (src2 == INVALID_REG) ? INVALID_REG : src2 + base;
+  //the reorder buffer takes instructions in order, so once it is full nothing issues
+  if (robSize > 0 && robCount == robSize) {
+    p_stats->issue_stall++;
+    p_stats->rob_full_stall++;
+    lastStall = STALL_ROB_FULL;
+    return false;
+  }
+  //unified uses its one reservation station, perFU the one for this op type, and clustered the
+  //one steering picks (-1 when that cluster is full)
+  int s = (numClusters > 1) ? steer(src1, src2) : stationOf[op];
+  //no space, add a stall
+  if (s == -1 || stations[s].currSize == stations[s].maxSize) {
+    p_stats->issue_stall++;
+    p_stats->rs_full_stall++;
+    lastStall = STALL_RS_FULL;
+    return false;
+  }
+  //renaming also needs a free physical register for the destination
+  if (renaming && freePhys.empty()) {
+    p_stats->issue_stall++;
+    p_stats->rename_stall++;
+    lastStall = STALL_RENAME;
+    return false;
+  }
+  reservationStation &station = stations[s];
+
+  //take the lowest free slot: skip full words, then count trailing zeros of the free bits
+  int w = (station.base >> 6) + station.freeWord;
+  while (occupiedBits[w] == ~(uint64_t)0) {
+    w++;
+  }
+  station.freeWord = w - (station.base >> 6);
+  int e = (w << 6) + __builtin_ctzll(~occupiedBits[w]);
+  setBit(occupiedBits, e);
+  station.currSize++;
+  instruction &inst = entries[e];
+  //a variable latency is drawn once the instruction is known to issue
+  if (latencyModels[op]) {
+    c = latencyModels[op]->sample();
+  }
+  inst = {op, dest, src1, src2, c, current_cycle, numIssued++, 0, s, -1, -1, -1, -1, 0, thread};
+  //clusters share the result buses, so their completions clear oldest first across clusters
+  clearKeys[e] = ((uint64_t)(numClusters > 1 ? 0 : s) << 56) | inst.issueOrder;
+  int &waitCount = waitCounts[e];
+  waitCount = 0;
+  readyCycles[e] = current_cycle;
+  int oldPhys = -1;
+
+  if (renaming) {
+    //read the sources through the current mappings, then give the destination a fresh register
+    inst.physSrc1 = (src1 == INVALID_REG) ? -1 : renameMap[src1 - 1];
+    inst.physSrc2 = (src2 == INVALID_REG) ? -1 : renameMap[src2 - 1];
+    for (int k = 1; k < 3; k++) {
+      int p = waitReg(inst, k);
+      if (p != -1) {
+        physReaders[p]++;
       }
-    //if mem instruction
-    } else if (op == 2) {
-      // if space in mem reservation station
-      if (rs->currMemSize < rs->maxMemSize) {
-        //get the number of cycles this instruction will run for
-        int c = get_inst_latency(op);
-        //add instruction to mem reservation station
-        rs->memRS[rs->currMemSize] = {op, dest, src1, src2, c, current_cycle, false};
-        //increase num instructions, current mem reservation size and current pipeline size
-        p_stats->num_insts++;
-        rs->currMemSize++;
-        currPipelineSize++;
-        //succesfully scheduled
-        return true;
-      } else {
-        //no space, increase stall counter
-        p_stats->issue_stall++;
-        return false;
+    }
+    oldPhys = renameMap[dest - 1];
+    inst.physDest = freePhys.back();
+    freePhys.pop_back();
+    physReady[inst.physDest] = 0;
+    renameMap[dest - 1] = inst.physDest;
+    //with a reorder buffer the old mapping is only replaced for good once this commits
+    if (robSize == 0) {
+      physSuperseded[oldPhys] = 1;
+      releasePhys(oldPhys);
+    }
+  }
+
+  //note which writer each source reads, then make this the writer later readers of the destination
+  //wait for (and steer towards until its value is produced)
+  for (int k = 1; k < 3; k++) {
+    int r = sourceReg(inst, k);
+    sourceProducers[e * 2 + k - 1] = (r == -1) ? NO_PRODUCER : producerOrder[r];
+  }
+  int written = renaming ? inst.physDest : dest - 1;
+  producerCluster[written] = clusterOf[s];
+  producerOrder[written] = inst.issueOrder;
+  nextCluster = (clusterOf[s] + 1) % numClusters;
+  p_stats->cluster_insts[clusterOf[s]]++;
+
+  //take the next reorder buffer entry
+  if (robSize > 0) {
+    inst.robSlot = (robHead + robCount) % robSize;
+    rob[inst.robSlot].done = false;
+    rob[inst.robSlot].issueOrder = inst.issueOrder;
+    rob[inst.robSlot].thread = thread;
+    rob[inst.robSlot].oldPhys = oldPhys;
+    robCount++;
+    if (robCount > (int)p_stats->max_rob_occupancy) {
+      p_stats->max_rob_occupancy = robCount;
+    }
+  }
+
+  //join the wakeup list of each register it waits on, counting the ones already busy
+  for (int k = 0; k < 3; k++) {
+    int r = waitReg(inst, k);
+    if (r != -1) {
+      int node = e * 3 + k;
+      waitPrev[node] = -1;
+      waitNext[node] = waitHead[r];
+      if (waitHead[r] != -1) {
+        waitPrev[waitHead[r]] = node;
       }
-    } 
+      waitHead[r] = node;
+      waitCount += regBusy(r) ? 1 : 0;
+    }
   }
-  //didn't correctly send an instruction, stall
-  return false;
+  if (waitCount == 0) {
+    markReady(e);
+  }
+
+  //queue it behind every older unfired instruction (renaming fires from the ready queue instead)
+  if (!renaming) {
+    nextUnfired[e] = -1;
+    if (unfiredTail[thread] != -1) {
+      nextUnfired[unfiredTail[thread]] = e;
+    } else {
+      unfiredHead[thread] = e;
+    }
+    unfiredTail[thread] = e;
+  }
+  unfiredPerThread[thread]++;
+  p_stats->thread_insts[thread]++;
+
+  //increase num instructions and current pipeline size
+  p_stats->num_insts++;
+  currPipelineSize++;
+  numUnfired++;
+  //successfully scheduled
+  return true;
+}
+
+/**
+ * Subroutine that issues up to count instructions in one cycle, in order, stopping at the first
+ * one that does not fit in its reservation station (which counts as the cycle's issue stall)
+ *
+ * @param[in]   insts           The instructions, oldest first
+ * @param[in]   count           How many of them to try, at most the issue width
+ * @param[out]  p_stats         Pointer to the stats structure
+ *
+ * @return                      How many were issued
+ */
+int Scheduler::try_issue_group(const trace_inst_t insts[], int count, scheduler_stats_t* p_stats, int thread) {
+  int issued = 0;
+  while (issued < count && try_issue(insts[issued].op, insts[issued].dest, insts[issued].src1, insts[issued].src2, p_stats, thread)) {
+    issued++;
+  }
+  //cycles issuing nothing are worked out at the end
+  if (issued > 0) {
+    p_stats->issue_width_hist[issued]++;
+  }
+  return issued;
 }
 
 /**
@@ -239,18 +534,9 @@ bool scheduler_try_issue(op_type op, int dest, int src1, int src2, scheduler_sta
  *
  * @return                      true if no instructions are left
  */
-bool scheduler_completed() {
-  //if unified
-	if (rsType == 0) {
-    //true when nothing is left in reservation station
-    return currResSize == 0;
-  //if perFU
-	} else if (rsType == 1) {
-    //true if pipeline is drained
-		return currPipelineSize == 0;
-	}
-  //scheduler wasn't set correctly
-  return false;
+bool Scheduler::completed() const {
+  //true if pipeline is drained and everything has committed
+  return currPipelineSize == 0 && robCount == 0;
 }
 
 /**
@@ -258,309 +544,250 @@ bool scheduler_completed() {
  *
  * @param[out]  p_stats         Pointer to the stats structure
  */
-void scheduler_step(scheduler_stats_t* p_stats) {
+void Scheduler::step(scheduler_stats_t* p_stats) {
   //increment cycle counters
 	p_stats->num_cycles++;
   current_cycle++;
-  scheduler_clear_completed(p_stats);
-  scheduler_start_ready(p_stats);
-}
-
-/**
- * Helper function used to check for RAT collisions, outputs a boolean to 
- * indicate whether a collision has happened or not
- *
- * @param  rs         instruction being checked against RAT
- */
-bool ratCollisionCheck(instruction rs) {
-  //if WAW hazard
-	if (rat[rs.destination - 1] == 1) {
-		return true;
-	}
-  //if RAW hazard
-	if (rat[rs.src1 - 1] == 1) {
-		return true;
-	}
-  //if RAW hazard
-	if (rat[rs.src2 - 1] == 1) {
-		return true;
-	}
-  //no collision
-	return false;
-}
-
-/**
- * Helper function for special case when all three reservation stations for 
- * perFU have the ability to fire.
- *
- * @param  addInactive        location in the add reservation station where   
- *                            the next inactive instruction is
- * @param  divInactive        location in the div reservation station where   
- *                            the next inactive instruction is
- * @param  memInactive        location in the mem reservation station where   
- *                            the next inactive instruction is
- */
-bool checkAllThree(int addInactive, int divInactive, int memInactive) {
-  //if the add reservation station has the earliest issued instruction
-  if (rs->addRS[addInactive].cycleIssued <= rs->divRS[divInactive].cycleIssued && rs->addRS[addInactive].cycleIssued <= rs->memRS[memInactive].cycleIssued) {
-    //check to see if there's a RAT collision
-    if (!ratCollisionCheck(rs->addRS[addInactive])) {
-      //set the register being written to as busy in the RAT
-      rat[rs->addRS[addInactive].destination - 1] = 1;
-      //set instruction to being fired
-      rs->addRS[addInactive].active = true;
-      //increase number of instructions fired this cycle counter
-      numFired_FU++;
-      //try to keep scheduling this cycle
-      return false;
-    } else {
-      //we had a collision, stop scheduling for this cycle
-      return true;
-    }
-  //if the div reservation station has the earliest issued instruction
-  } else if (rs->divRS[divInactive].cycleIssued <= rs->addRS[addInactive].cycleIssued && rs->divRS[divInactive].cycleIssued <= rs->memRS[memInactive].cycleIssued) {
-    //check to see if there's a RAT collision
-    if (!ratCollisionCheck(rs->divRS[divInactive])) {
-      //set the register being written to as busy in the RAT
-      rat[rs->divRS[divInactive].destination - 1] = 1;
-      //set instruction to being fired
-      rs->divRS[divInactive].active = true;
-      //increase number of instructions fired this cycle counter
-      numFired_FU++;
-      //try to keep scheduling this cycle
-      return false;
+  //instructions completed in earlier cycles commit before this cycle's completions
+  commit(p_stats);
+  clear_completed(p_stats);
+  start_ready(p_stats);
+  sampleOccupancy(p_stats, 1);
+}
+
+/**
+ * Helper function that charges cycles in which nothing fired to why the next instruction could not
+ * fire: none left, a busy source (RAW), only a busy destination (WAW), or no free unit
+ *
+ * @param  p_stats    Pointer to the stats structure
+ * @param  cycles     how many such cycles
+ */
+void Scheduler::countNoFire(scheduler_stats_t* p_stats, uint64_t cycles) const {
+  if (numUnfired == 0) {
+    p_stats->no_fire_empty += cycles;
+  } else if (renaming) {
+    //renamed instructions only ever wait on their sources (or for them to be bypassed)
+    if (!unitBlocked) {
+      p_stats->no_fire_raw += cycles;
     } else {
-      //we had a collision, stop scheduling for this cycle
-      return true;
+      p_stats->no_fire_fu_busy += cycles;
     }
-  //if the mem reservation station has the earliest issued instruction
-  } else if (rs->memRS[memInactive].cycleIssued <= rs->addRS[addInactive].cycleIssued && rs->memRS[memInactive].cycleIssued <= rs->divRS[divInactive].cycleIssued){
-    //check to see if there's a RAT collision
-    if (!ratCollisionCheck(rs->memRS[memInactive])) {
-      //set the register being written to as busy in the RAT
-      rat[rs->memRS[memInactive].destination - 1] = 1;
-      //set instruction to being fired
-      rs->memRS[memInactive].active = true;
-      //increase number of instructions fired this cycle counter
-      numFired_FU++;
-      //try to keep scheduling this cycle
-      return false;
+  } else if (oldestUnfired(true, false) != -1) {
+    p_stats->no_fire_fu_busy += cycles;
+  } else {
+    int e = unfiredHead[oldestUnfired(false, false)];
+    const instruction &inst = entries[e];
+    //a source still on its way through the bypass counts as busy
+    bool srcBusy = (inst.src1 != INVALID_REG && rat[inst.src1 - 1]) || (inst.src2 != INVALID_REG && rat[inst.src2 - 1]) ||
+                   testBit(readyBits, e);
+    if (srcBusy) {
+      p_stats->no_fire_raw += cycles;
     } else {
-      //we had a collision, stop scheduling for this cycle
-      return true;
+      p_stats->no_fire_waw += cycles;
     }
   }
-  //parameter was not set correctly, stop scheduling
-  return true;
 }
 
 /**
- * Helper function to determine earliest issued instruction for perFU  
- * scheduler
+ * Helper function that adds cycles spent at the current reservation station and reorder buffer
+ * occupancies
+ *
+ * @param  p_stats    Pointer to the stats structure
+ * @param  cycles     how many cycles
  */
-bool functionalHelper() {
-  //set locations of inactive instructions to -1 (not existing)
-  int divInactive = -1;
-  int memInactive = -1;
-  int addInactive = -1;
-  //location counter variable j
-  int j = 0;
-  //while we haven't looked through all indexes or found an inactive index
-  while (j < rs->currAddSize && addInactive == -1) {
-    //if inactive
-    if (!rs->addRS[j].active) {
-      //found, break while loop
-      addInactive = j;
-    } else {
-      j++;
-    }
+void Scheduler::sampleOccupancy(scheduler_stats_t* p_stats, uint64_t cycles) const {
+  for (int s = 0; s < numStations; s++) {
+    p_stats->rs_occupancy_hist[s][min(stations[s].currSize, MAX_RS_OCCUPANCY_BUCKET)] += cycles;
   }
+  p_stats->rob_occupancy += (uint64_t)robCount * cycles;
+}
 
-  j = 0;
-  //while we haven't looked through all indexes or found an inactive index
-  while (j < rs->currDivSize && divInactive == -1) {
-    //if inactive
-    if (!rs->divRS[j].active) {
-      //found, break while loop
-      divInactive = j;
-    } else {
-      j++;
+/**
+ * Helper function that raises max_active to the number of active instructions per FU
+ *
+ * @param  p_stats    Pointer to the stats structure
+ */
+void Scheduler::updateMaxActive(scheduler_stats_t* p_stats) const {
+  //update p_stats structure with new max_active values for each functional unit ONLY if they are higher
+  for (int op = 0; op < config.num_classes; op++) {
+    if (numActive[op] > (int)p_stats->max_active[op]) {
+      p_stats->max_active[op] = numActive[op];
     }
   }
+}
 
-  j = 0;
-  //while we haven't looked through all indexes or found an inactive index
-  while (j < rs->currMemSize && memInactive == -1) {
-    // if inactive
-    if (!rs->memRS[j].active) {
-      //found, break while loop
-      memInactive = j;
+/**
+ * Subroutine that skips over cycles in which nothing can happen. Every step fires until it hits
+ * a RAT collision or runs out of instructions, so until something completes (or a new instruction
+ * is issued) each further step would only count down the active instructions. This jumps straight
+ * to the step before the next completion and accounts for the skipped steps in bulk.
+ *
+ * @param[out]  p_stats         Pointer to the stats structure
+ * @param[in]   stalled         true if the driver is retrying an instruction that failed to issue,
+ *                              so every skipped step is also an issue stall
+ */
+void Scheduler::skip_idle(scheduler_stats_t* p_stats, bool stalled) {
+  //nothing is running, so there is no next event to skip to
+  if (dueCycles.empty()) {
+    return;
+  }
+  //a lone instruction is only cleared once it has no cycles left, one cycle after it is due
+  int nextEvent = dueCycles.top().first + (currPipelineSize == 1 ? 1 : 0);
+  int skip = nextEvent - current_cycle - 1;
+  //an instruction held back only by its FU units may fire before anything completes
+  if (skip <= 0 || headReady() || !readyQueue.empty()) {
+    return;
+  }
+  //nor can a completed instruction waiting to commit
+  if (robCount > 0 && rob[robHead].done) {
+    return;
+  }
+  //every skipped step sees the same active set
+  updateMaxActive(p_stats);
+  //advance the clock as if the steps had run
+  p_stats->num_cycles += skip;
+  current_cycle += skip;
+  //nothing fires or changes occupancy in the skipped steps
+  countNoFire(p_stats, skip);
+  sampleOccupancy(p_stats, skip);
+  if (stalled) {
+    p_stats->issue_stall += skip;
+    if (lastStall == STALL_ROB_FULL) {
+      p_stats->rob_full_stall += skip;
+    } else if (lastStall == STALL_RENAME) {
+      p_stats->rename_stall += skip;
     } else {
-      j++;
+      p_stats->rs_full_stall += skip;
     }
   }
+}
 
-  //if nothing is inactive, stop trying to fire
-  if (divInactive == -1 && memInactive == -1 && addInactive == -1) {
-    return true;
-  //if nothing is inactive in div and mem, try to schedule add
-  } else if (divInactive == -1 && memInactive == -1) {
-    //check to see if there's a RAT collision
-    if (!ratCollisionCheck(rs->addRS[addInactive])) {
-      //set the register being written to as busy in the RAT
-      rat[rs->addRS[addInactive].destination - 1] = 1;
-      //set instruction to being fired
-      rs->addRS[addInactive].active = true;
-      //increase number of instructions fired this cycle counter
-      numFired_FU++;
-      //try to keep scheduling this cycle
-      return false;
-    } else {
-      //we had a collision, stop scheduling for this cycle
-      return true;
-    }
-  //if nothing is inactive in add and mem, try to schedule div
-  } else if (addInactive == -1 && memInactive == -1) {
-    //check to see if there's a RAT collision
-    if (!ratCollisionCheck(rs->divRS[divInactive])) {
-      //set the register being written to as busy in the RAT
-      rat[rs->divRS[divInactive].destination - 1] = 1;
-      //set instruction to being fired
-      rs->divRS[divInactive].active = true;
-      //increase number of instructions fired this cycle counter
-      numFired_FU++;
-      //try to keep scheduling this cycle
-      return false;
-    } else {
-      //we had a collision, stop scheduling for this cycle
-      return true;
+/**
+ * Helper function that adds delta to the wait count of every unfired instruction naming a register
+ *
+ * @param  r          RAT index (or physical register) of the register
+ * @param  delta      1 when the register becomes busy, -1 when it is freed
+ * @param  writer     the instruction that fired or completed writing it
+ */
+void Scheduler::wakeWaiters(int r, int delta, const instruction &writer) {
+  for (int node = waitHead[r]; node != -1; node = waitNext[node]) {
+    int e = node / 3;
+    waitCounts[e] += delta;
+    //a freed source reaches its reader through the bypass, but a register it only writes holds
+    //nothing back once freed
+    const instruction &reader = entries[e];
+    int k = (sourceReg(reader, 1) == r) ? 1 : (sourceReg(reader, 2) == r) ? 2 : 0;
+    if (delta < 0 && k != 0) {
+      int arrival = current_cycle + bypassLatency;
+      //the value it reads comes from another cluster clusterDelay cycles after a local one would
+      if (sourceProducers[e * 2 + k - 1] == writer.issueOrder && clusterOf[reader.station] != clusterOf[writer.station]) {
+        arrival += clusterDelay;
+        crossClusterWakeups++;
+      }
+      readyCycles[e] = max(readyCycles[e], arrival);
     }
-  //if nothing is inactive in add and div, try to schedule mem
-  } else if (divInactive == -1 && addInactive == -1) {
-    //check to see if there's a RAT collision
-    if (!ratCollisionCheck(rs->memRS[memInactive])) {
-      //set the register being written to as busy in the RAT
-      rat[rs->memRS[memInactive].destination - 1] = 1;
-      //set instruction to being fired
-      rs->memRS[memInactive].active = true;
-      //increase number of instructions fired this cycle counter
-      numFired_FU++;
-      //try to keep scheduling this cycle
-      return false;
+    //ready exactly while it waits on nothing, and fireable once its last source has been bypassed
+    if (waitCounts[e] == 0) {
+      readyCycles[e] = max(readyCycles[e], current_cycle);
+      markReady(e);
     } else {
-      //we had a collision, stop scheduling for this cycle
-      return true;
+      clearBit(readyBits, e);
     }
-  //if nothing is inactive in mem, pick earliest issued instruction between add and div
-  } else if (memInactive == -1) {
-    //if add instruction was issued earlier than div
-    if (rs->addRS[addInactive].cycleIssued <= rs->divRS[divInactive].cycleIssued) {
-      //check to see if there's a RAT collision
-      if (!ratCollisionCheck(rs->addRS[addInactive])) {
-        //set the register being written to as busy in the RAT
-        rat[rs->addRS[addInactive].destination - 1] = 1;
-        //set instruction to being fired
-        rs->addRS[addInactive].active = true;
-        //increase number of instructions fired this cycle counter
-        numFired_FU++;
-        //try to keep scheduling this cycle
-        return false;
+  }
+}
+
+/**
+ * Helper function that fires an instruction: takes it off the wakeup lists, marks its destination
+ * busy in the RAT (so everything naming it has to wait), sets it active and records the cycle it
+ * is due to complete (the clear that first sees it with one cycle left)
+ *
+ * @param  e          entry of the instruction being fired
+ */
+void Scheduler::fireInstruction(int e) {
+  instruction &inst = entries[e];
+  //a fired instruction no longer waits on anything
+  for (int k = 0; k < 3; k++) {
+    int r = waitReg(inst, k);
+    if (r != -1) {
+      int node = e * 3 + k;
+      if (waitPrev[node] != -1) {
+        waitNext[waitPrev[node]] = waitNext[node];
       } else {
-        //we had a collision, stop scheduling for this cycle
-        return true;
+        waitHead[r] = waitNext[node];
       }
-    //else, div was earlier than add
-    } else {
-      //check to see if there's a RAT collision
-      if (!ratCollisionCheck(rs->divRS[divInactive])) {
-        //set the register being written to as busy in the RAT
-        rat[rs->divRS[divInactive].destination - 1] = 1;
-        //set instruction to being fired
-        rs->divRS[divInactive].active = true;
-        //increase number of instructions fired this cycle counter
-        numFired_FU++;
-        //try to keep scheduling this cycle
-        return false;
-      } else {
-        //we had a collision, stop scheduling for this cycle
-        return true;
+      if (waitNext[node] != -1) {
+        waitPrev[waitNext[node]] = waitPrev[node];
       }
-    }
-  //if nothing is inactive in div, pick earliest issued instruction between add and mem
-  } else if (divInactive == -1) {
-    //if mem instruction was issued earlier than add
-    if (rs->memRS[memInactive].cycleIssued <= rs->addRS[addInactive].cycleIssued) {
-      //check to see if there's a RAT collision
-      if (!ratCollisionCheck(rs->memRS[memInactive])) {
-        //set the register being written to as busy in the RAT
-        rat[rs->memRS[memInactive].destination - 1] = 1;
-        //set instruction to being fired
-        rs->memRS[memInactive].active = true;
-        //increase number of instructions fired this cycle counter
-        numFired_FU++;
-        //try to keep scheduling this cycle
-        return false;
-      } else {
-        //we had a collision, stop scheduling for this cycle
-        return true;
-      }
-    //else, add was earlier than mem
-    } else {
-      //check to see if there's a RAT collision
-      if (!ratCollisionCheck(rs->addRS[addInactive])) {
-        //set the register being written to as busy in the RAT
-        rat[rs->addRS[addInactive].destination - 1] = 1;
-        //set instruction to being fired
-        rs->addRS[addInactive].active = true;
-        //increase number of instructions fired this cycle counter
-        numFired_FU++;
-        //try to keep scheduling this cycle
-        return false;
-      } else {
-        //we had a collision, stop scheduling for this cycle
-        return true;
+      //renaming: it has read its source, which may now be free
+      if (renaming) {
+        physReaders[r]--;
+        releasePhys(r);
       }
     }
-  //if nothing is inactive in add, pick earliest issued instruction between div and mem
-  } else if (addInactive == -1) {
-    //if mem instruction was issued earlier than div
-    if (rs->memRS[memInactive].cycleIssued <= rs->divRS[divInactive].cycleIssued) {
-      //set the register being written to as busy in the RAT
-      if (!ratCollisionCheck(rs->memRS[memInactive])) {
-        //set the register being written to as busy in the RAT
-        rat[rs->memRS[memInactive].destination - 1] = 1;
-        //set instruction to being fired
-        rs->memRS[memInactive].active = true;
-        numFired_FU++;
-        //try to keep scheduling this cycle
-        return false;
-      } else {
-        //we had a collision, stop scheduling for this cycle
-        return true;
-      }
-    //else, div was earlier than add
-    } else {
-      //set the register being written to as busy in the RAT
-      if (!ratCollisionCheck(rs->divRS[divInactive])) {
-        //set the register being written to as busy in the RAT
-        rat[rs->divRS[divInactive].destination - 1] = 1;
-        //set instruction to being fired
-        rs->divRS[divInactive].active = true;
-        //increase number of instructions fired this cycle counter
-        numFired_FU++;
-        //try to keep scheduling this cycle
-        return false;
-      } else {
-        //we had a collision, stop scheduling for this cycle
-        return true;
+  }
+  //without renaming the destination is busy until it completes, holding back later readers and
+  //writers alike; renamed readers already wait on the destination's physical register
+  if (!renaming) {
+    rat[inst.destination - 1] = 1;
+    wakeWaiters(inst.destination - 1, 1, inst);
+  }
+  clearBit(readyBits, e);
+  inst.cycleFired = current_cycle;
+  inst.dueCycle = current_cycle + inst.latency;
+  dueCycles.push(make_pair(inst.dueCycle, e));
+  numActive[inst.opcode]++;
+  clusterActive[clusterOf[inst.station]][inst.opcode]++;
+  clusterFired[clusterOf[inst.station]][inst.opcode]++;
+  numUnfired--;
+  unfiredPerThread[inst.thread]--;
+}
+
+/**
+ * Helper function that checks whether an FU class has a unit free to take an instruction this
+ * cycle. A pipelined unit takes one new instruction per cycle, an unpipelined one is busy until
+ * its instruction completes.
+ *
+ * @param  fu_class   FU class of the instruction
+ * @param  station    reservation station of the instruction, whose cluster has the units
+ */
+bool Scheduler::unitAvailable(int fu_class, int station) const {
+  const fu_class_t &fu = config.classes[fu_class];
+  if (fu.units == 0) {
+    return true;
+  }
+  int k = clusterOf[station];
+  return (fu.pipelined ? clusterFired[k][fu_class] : clusterActive[k][fu_class]) < fu.units;
+}
+
+/**
+ * Helper function that picks the cluster an instruction issues to, or -1 if it must stall.
+ * Round-robin takes the clusters in turn and stalls on a full one. Dependence-based follows the
+ * producer of a source still in flight, so its value need not cross clusters, and otherwise (or if
+ * that cluster is full) takes the emptiest cluster.
+ *
+ * @param  src1       first source register (INVALID_REG if unused), in the thread's registers
+ * @param  src2       second source register (INVALID_REG if unused), in the thread's registers
+ */
+int Scheduler::steer(int src1, int src2) const {
+  if (steering == STEER_ROUND_ROBIN) {
+    return (stations[nextCluster].currSize < stations[nextCluster].maxSize) ? nextCluster : -1;
+  }
+  int srcs[2] = {src1, src2};
+  for (int k = 0; k < 2; k++) {
+    if (srcs[k] != INVALID_REG) {
+      int owner = producerCluster[renaming ? renameMap[srcs[k] - 1] : srcs[k] - 1];
+      if (owner != -1 && stations[owner].currSize < stations[owner].maxSize) {
+        return owner;
       }
     }
-  } else {
-    //special case, checkAllThree function
-    return checkAllThree(addInactive, divInactive, memInactive);
   }
-  //didn't hit any case, something went wrong, stop trying to fire
-  return true;
+  int best = 0;
+  for (int k = 1; k < numClusters; k++) {
+    if (stations[k].currSize < stations[best].currSize) {
+      best = k;
+    }
+  }
+  return (stations[best].currSize < stations[best].maxSize) ? best : -1;
 }
 
 /**
@@ -569,128 +796,60 @@ bool functionalHelper() {
  *
  * @param[out]  p_stats         Pointer to the stats structure
  */
-void scheduler_start_ready(scheduler_stats_t* p_stats) {
-  //if unified scheduler
-  if (rsType == 0) {
-    //did we check all reservation station locations
-    bool checkAll = false;
-    //how many instructions were fired this cycle
-    int numFired = 0;
-    //last started optimization, since we check from 0 to size, we can restart from the last instruction that was started
-    int lastStarted = 0;
-    //how many instructions are active perFU
-    int numAddActive = 0;
-    int numDivActive = 0;
-    int numMemActive = 0;
-    //loop through all instructions, decrement cycles left for active instructions and count how many instructions are active for each functional unit
-    for (int i = 0; i < currResSize; i++) {
-      if (resStation[i].active) {
-        resStation[i].cyclesLeft--;
-        if (resStation[i].opcode == 0) {
-          numAddActive++;
-        } else if (resStation[i].opcode == 1) {
-          numDivActive++;
-        } else if (resStation[i].opcode == 2) {
-          numMemActive++;
-        }
-      }
-    }
-    //update p_stats structure with new max_active values for each functional unit ONLY if they are higher
-    if (numAddActive > (int)p_stats->max_active[0]) {
-      p_stats->max_active[0] = numAddActive;
-    }
-    if (numDivActive > (int)p_stats->max_active[1]) {
-      p_stats->max_active[1] = numDivActive;
-    }
-    if (numMemActive > (int)p_stats->max_active[2]) {
-      p_stats->max_active[2] = numMemActive;
+void Scheduler::start_ready(scheduler_stats_t* p_stats) {
+  //the instructions fired in earlier cycles are the active ones this cycle
+  updateMaxActive(p_stats);
+
+  //how many instructions were fired this cycle
+  int numFired = 0;
+  for (int k = 0; k < numClusters; k++) {
+    for (int op = 0; op < config.num_classes; op++) {
+      clusterFired[k][op] = 0;
     }
-  	//loop and try to keep scheduling
-    while (!checkAll) {
-      //set counter to where we left off last cycle
-    	int j = lastStarted;
-      //set inactive instruction to not existing
-    	int inactive = -1;
-      //have we found an inactive value
-      int found = 0;
-      //while we haven't checked every reservation station instruction OR found an inactive instruction
-    	while (j < currResSize && inactive == -1) {
-        //if index is inactive
-    		if (!resStation[j].active) {
-          //update inactive and set found to 1
-    			inactive = j;
-          found = 1;
-    		} else {
-    			j++;
-    		}
-    	}
-      //if we found an inactive instruction in the reservation station, check for RAT collision
-    	if (found == 1 && !ratCollisionCheck(resStation[j])) {
-    		//set the register being written to as busy in the RAT
-    		rat[resStation[j].destination - 1] = 1;
-        //set instruction to fired
-    		resStation[j].active = true;
-        //set lastStarted to last index we set to fired
-        lastStarted = j;
-        //increment the amount of instructions fired this cycle
+  }
+  //renaming: fire every ready instruction that has a free unit, oldest first. Clusters have their
+  //own units, so this is also each cluster selecting its oldest ready instructions on its own
+  if (renaming) {
+    deferred.clear();
+    unitBlocked = false;
+    while (!readyQueue.empty()) {
+      int e = readyQueue.top().second;
+      readyQueue.pop();
+      if (readyCycles[e] <= current_cycle && unitAvailable(entries[e].opcode, entries[e].station)) {
+        fireInstruction(e);
+        p_stats->fire_wait += current_cycle - entries[e].cycleIssued;
         numFired++;
-    	} else {
-        //we've looked at all instructions OR hit a collision, stop scheduling
-        checkAll = true;
-      }
-    }
-    //if we've fired more instructions this round than previous, update p_stats
-    if (numFired > (int)p_stats->max_fired) {
-      p_stats->max_fired = numFired;
-    }
-  // else scheduler type is 1, perFU
-  } else {
-    //did we check all reservation station locations
-    bool checkAll = false;
-    //how many instructions are active perFU
-    int numAddActive = 0;
-    int numDivActive = 0;
-    int numMemActive = 0;
-    //loop through all instructions, decrement cycles left for active instructions and count how many instructions are active for each functional unit
-    for (int i = 0; i < rs->currAddSize; i++) {
-      if (rs->addRS[i].active) {
-        rs->addRS[i].cyclesLeft--;
-        numAddActive++;
-      }
-    }
-    for (int i = 0; i < rs->currDivSize; i++) {
-      if (rs->divRS[i].active) {
-        rs->divRS[i].cyclesLeft--;
-        numDivActive++;
-      }
-    }
-    for (int i = 0; i < rs->currMemSize; i++) {
-      if (rs->memRS[i].active) {
-        rs->memRS[i].cyclesLeft--;
-        numMemActive++;
+      } else {
+        unitBlocked = unitBlocked || readyCycles[e] <= current_cycle;
+        deferred.push_back(e);
       }
     }
-    //update p_stats structure with new max_active values for each functional unit ONLY if they are higher
-    if (numAddActive > (int)p_stats->max_active[0]) {
-      p_stats->max_active[0] = numAddActive;
+    for (size_t i = 0; i < deferred.size(); i++) {
+      readyQueue.push(make_pair(entries[deferred[i]].issueOrder, deferred[i]));
     }
-    if (numDivActive > (int)p_stats->max_active[1]) {
-      p_stats->max_active[1] = numDivActive;
-    }
-    if (numMemActive > (int)p_stats->max_active[2]) {
-      p_stats->max_active[2] = numMemActive;
-    }
-    //reset number of instructions fired this cycle to 0
-    numFired_FU = 0;
-    //while we haven't exhausted all firing options
-    while (!checkAll) {
-      //try to fire instructions
-      checkAll = functionalHelper();
-    }
-    //if we've fired more instructions this cycle, update p_stats
-    if (numFired_FU > (int)p_stats->max_fired) {
-      p_stats->max_fired = numFired_FU;
+  }
+  //fire oldest first until the oldest unfired instruction of every thread collides in the RAT, has
+  //no free unit, or none are left. This is program order across clusters too, since an instruction
+  //firing ahead of an older unfired one could read a register before that one writes it
+  int t;
+  while ((t = oldestUnfired(true, true)) != -1) {
+    int e = unfiredHead[t];
+    unfiredHead[t] = nextUnfired[e];
+    if (unfiredHead[t] == -1) {
+      unfiredTail[t] = -1;
     }
+    fireInstruction(e);
+    p_stats->fire_wait += current_cycle - entries[e].cycleIssued;
+    //increment the amount of instructions fired this cycle
+    numFired++;
+  }
+  p_stats->num_fired += numFired;
+  if (numFired == 0) {
+    countNoFire(p_stats, 1);
+  }
+  //if we've fired more instructions this round than previous, update p_stats
+  if (numFired > (int)p_stats->max_fired) {
+    p_stats->max_fired = numFired;
   }
 }
 
@@ -700,189 +859,200 @@ void scheduler_start_ready(scheduler_stats_t* p_stats) {
  *
  * @param[out]  p_stats         Pointer to the stats structure
  */
-void scheduler_clear_completed(scheduler_stats_t* p_stats) {
-  //if unified scheduler
-  if (rsType == 0) {
-    //check all reservation station instructions
-  	bool checkAll = false;
-    //counter for how many instructions are completed this cycle
-    int numCompleted = 0;
-    //while we haven't checked all instructions in the reservation station
-  	while (!checkAll) {
-  		int i = 0;
-      //set location of a finished instruction to not existing
-  		int finishedInst = -1;
-      //while we haven't looked at all instructions in the reservation station OR we haven't found one that is completed
-  		while (i < currResSize && finishedInst == -1) {
-        //if the instruction has one cycle left, there isn't only one instruction in the reservation station
-  			if (resStation[i].cyclesLeft == 1 && currResSize != 1) {
-          //the instruction is finished
-  				finishedInst = i;
-        //if the instruction has no cycles left
-  			} else if (resStation[i].cyclesLeft == 0) {
-          //the instruction is finished
-          finishedInst = i;
-        }
-  			i++;
-  		}
-      //if there are no finished instructions
-  		if (finishedInst == -1) {
-        //we've checked all, stop clearing
-  			checkAll = true;
-      //remove finished instruction
-  		} else {
-        //set RAT value to not busy
-  			rat[resStation[finishedInst].destination - 1] = 0;
-        //shift all values after the finished instruction in the reservation station one index down
-  			for (int j = finishedInst; j < currResSize - 1; j++) {
-  				resStation[j] = resStation[j+1];
-  			}
-        //decrease current size of reservation station
-  			currResSize--;
-        //increment number of instructions finished this cycle
-	  		numCompleted++;
-  		}
-  	}
-    //if we've finished more instructions this cycle than previously, update p_stats
-    if (numCompleted > (int)p_stats->max_completed) {
-      p_stats->max_completed = numCompleted;
-    }
-  //else if perFU scheduler
-  } else if (rsType == 1) {
-    //check all reservation station instructions
-    bool checkAll = false;
-    //counter for how many instructions are completed this cycle
-    int numCompleted = 0;
-    //while we haven't checked all instructions in add reservation station
-    while (!checkAll) {
-      int i = 0;
-      //set location of a finished instruction to not existing
-      int finishedInst = -1;
-      //while we haven't looked at all instructions in the add reservation station OR we haven't found one that is completed
-      while (i < rs->currAddSize && finishedInst == -1) {
-        //if the instruction has one cycle left, there isn't only one instruction in the reservation station
-        if (rs->addRS[i].cyclesLeft == 1 && currPipelineSize != 1) {
-          //the instruction is finished
-          finishedInst = i;
-        //if the instruction has no cycles left
-        } else if (rs->addRS[i].cyclesLeft == 0) {
-          //the instruction is finished
-          finishedInst = i;
-        }
-        i++;
-      }
-      //if there are no finished instructions
-      if (finishedInst == -1) {
-        //we've checked all, stop clearing
-        checkAll = true;
-      //remove finished instruction
+void Scheduler::clear_completed(scheduler_stats_t* p_stats) {
+  //counter for how many instructions are completed this cycle
+  int numCompleted = 0;
+  //whether a finished instruction lost result bus arbitration
+  bool contended = false;
+  //only instructions that are due have one cycle left (or none, if held back last cycle)
+  candidates.clear();
+  while (!dueCycles.empty() && dueCycles.top().first <= current_cycle) {
+    int e = dueCycles.top().second;
+    candidates.push_back(make_pair(clearKeys[e], e));
+    dueCycles.pop();
+  }
+  //clear them oldest first per reservation station (perFU: ADD, then DIV, then MEM)
+  sort(candidates.begin(), candidates.end());
+  for (size_t i = 0; i < candidates.size(); i++) {
+    int e = candidates[i].second;
+    instruction &inst = entries[e];
+    //finished if it has one cycle left and isn't the only instruction in the pipeline, or no cycles left
+    bool finished = currPipelineSize != 1 || inst.dueCycle < current_cycle;
+    if (finished && cdbWidth > 0 && numCompleted == cdbWidth) {
+      //every result bus is taken (by earlier stations and older instructions), retry next cycle
+      dueCycles.push(make_pair(inst.dueCycle, e));
+      p_stats->cdb_delayed++;
+      contended = true;
+    } else if (finished) {
+      if (renaming) {
+        //its value is produced: wake its readers, and free the register if it was already replaced
+        physReady[inst.physDest] = 1;
+        wakeWaiters(inst.physDest, -1, inst);
+        releasePhys(inst.physDest);
       } else {
-        //set RAT value to not busy
-        rat[rs->addRS[finishedInst].destination - 1] = 0;
-        //shift all values after the finished instruction in the add reservation station one index down
-        for (int j = finishedInst; j < rs->currAddSize - 1; j++) {
-          rs->addRS[j] = rs->addRS[j+1];
-        }
-        //decrease current size of pipeline
-        currPipelineSize--;
-        //decrease current size of add reservation station
-        rs->currAddSize--;
-        //increment number of instructions finished this cycle
-        numCompleted++;
+        //set RAT value to not busy and wake every instruction waiting on it
+        rat[inst.destination - 1] = 0;
+        wakeWaiters(inst.destination - 1, -1, inst);
       }
-    }
-    checkAll = false;
-    //while we haven't checked all instructions in div reservation station
-    while (!checkAll) {
-      int i = 0;
-      //set location of a finished instruction to not existing
-      int finishedInst = -1;
-      //while we haven't looked at all instructions in the div reservation station OR we haven't found one that is completed
-      while (i < rs->currDivSize && finishedInst == -1) {
-        //if the instruction has one cycle left, there isn't only one instruction in the reservation station
-        if (rs->divRS[i].cyclesLeft == 1 && currPipelineSize != 1) {
-          //the instruction is finished
-          finishedInst = i;
-        //if the instruction has no cycles left
-        } else if (rs->divRS[i].cyclesLeft == 0) {
-          //the instruction is finished
-          finishedInst = i;
-        }
-        i++;
+      //its readers no longer need to steer towards it
+      int written = renaming ? inst.physDest : inst.destination - 1;
+      if (producerOrder[written] == inst.issueOrder) {
+        producerCluster[written] = -1;
       }
-      //if there are no finished instructions
-      if (finishedInst == -1) {
-        //we've checked all, stop clearing
-        checkAll = true;
-      //remove finished instruction
+      clusterActive[clusterOf[inst.station]][inst.opcode]--;
+      //it may commit from the next cycle on
+      if (inst.robSlot != -1) {
+        rob[inst.robSlot].done = true;
       } else {
-        //set RAT value to not busy
-        rat[rs->divRS[finishedInst].destination - 1] = 0;
-        //shift all values after the finished instruction in the div reservation station one index down
-        for (int j = finishedInst; j < rs->currDivSize - 1; j++) {
-          rs->divRS[j] = rs->divRS[j+1];
-        }
-        //decrease current size of pipeline
-        currPipelineSize--;
-        //decrease current size of div reservation station
-        rs->currDivSize--;
-        //increment number of instructions finished this cycle
-        numCompleted++;
+        p_stats->thread_cycles[inst.thread] = p_stats->num_cycles;
       }
-    }
-    checkAll = false;
-    //while we haven't checked all instructions in mem reservation station
-    while (!checkAll) {
-      int i = 0;
-      //set location of a finished instruction to not existing
-      int finishedInst = -1;
-      //while we haven't looked at all instructions in the mem reservation station OR we haven't found one that is completed
-      while (i < rs->currMemSize && finishedInst == -1) {
-        //if the instruction has one cycle left, there isn't only one instruction in the reservation station
-        if (rs->memRS[i].cyclesLeft == 1 && currPipelineSize != 1) {
-          //the instruction is finished
-          finishedInst = i;
-        //if the instruction has no cycles left
-        } else if (rs->memRS[i].cyclesLeft == 0) {
-          //the instruction is finished
-          finishedInst = i;
-        }
-        i++;
-      }
-      //if there are no finished instructions
-      if (finishedInst == -1) {
-        //we've checked all, stop clearing
-        checkAll = true;
-      //remove finished instruction
-      } else {
-        //set RAT value to not busy
-        rat[rs->memRS[finishedInst].destination - 1] = 0;
-        //shift all values after the finished instruction in the mem reservation station one index down
-        for (int j = finishedInst; j < rs->currMemSize - 1; j++) {
-          rs->memRS[j] = rs->memRS[j+1];
-        }
-        //decrease current size of pipeline
-        currPipelineSize--;
-        //decrease current size of div reservation station
-        rs->currMemSize--;
-        //increment number of instructions finished this cycle
-        numCompleted++;
+      if (pipeView != NULL) {
+        //the registers as the thread named them
+        int base = inst.thread * numRegisters;
+        trace_inst_t traced = {inst.opcode, inst.destination - base,
+                               inst.src1 == INVALID_REG ? INVALID_REG : inst.src1 - base,
+                               inst.src2 == INVALID_REG ? INVALID_REG : inst.src2 - base};
+        pipeView->completed(inst.issueOrder, traced, inst.cycleIssued, inst.cycleFired, current_cycle, inst.robSlot == -1);
       }
+      //free the slot in its reservation station
+      reservationStation &station = stations[inst.station];
+      clearBit(occupiedBits, e);
+      station.freeWord = min(station.freeWord, (e - station.base) >> 6);
+      station.currSize--;
+      numActive[inst.opcode]--;
+      //decrease current size of pipeline
+      currPipelineSize--;
+      //increment number of instructions finished this cycle
+      numCompleted++;
+    } else {
+      //held back until it has no cycles left
+      dueCycles.push(make_pair(inst.dueCycle, e));
     }
-    //if we've finished more instructions this cycle than previously, update p_stats
-    if (numCompleted > (int)p_stats->max_completed) {
-      p_stats->max_completed = numCompleted;
+  }
+  if (contended) {
+    p_stats->cdb_contention_cycles++;
+  }
+  //if we've finished more instructions this cycle than previously, update p_stats
+  if (numCompleted > (int)p_stats->max_completed) {
+    p_stats->max_completed = numCompleted;
+  }
+}
+
+/**
+ * Subroutine that commits completed instructions from the head of the reorder buffer, in issue
+ * order and at most commitWidth of them, freeing their reorder buffer entries
+ *
+ * @param[out]  p_stats         Pointer to the stats structure
+ */
+void Scheduler::commit(scheduler_stats_t* p_stats) {
+  int numCommitted = 0;
+  while (robCount > 0 && rob[robHead].done && (commitWidth == 0 || numCommitted < commitWidth)) {
+    //nothing can read the destination's previous physical register any more
+    if (renaming) {
+      physSuperseded[rob[robHead].oldPhys] = 1;
+      releasePhys(rob[robHead].oldPhys);
     }
+    if (pipeView != NULL) {
+      pipeView->retired(rob[robHead].issueOrder, current_cycle);
+    }
+    p_stats->thread_cycles[rob[robHead].thread] = p_stats->num_cycles;
+    robHead = (robHead + 1) % robSize;
+    robCount--;
+    numCommitted++;
+  }
+  if (numCommitted > (int)p_stats->max_committed) {
+    p_stats->max_committed = numCommitted;
   }
 }
 
 /**
  * Subroutine for completing the scheduler and getting any final stats
- * XXX You're responsible for completing this routine.
  *
  * @param[out]  p_stats         Pointer to the stats structure
  */
-void scheduler_complete(scheduler_stats_t* p_stats) {
+void Scheduler::complete(scheduler_stats_t* p_stats) {
   //calculate instructions per cycle
   p_stats->ipc = (double)p_stats->num_insts/(double)p_stats->num_cycles;
-}
\ No newline at end of file
+  p_stats->raw_wait = rawWaitCycles;
+  p_stats->cross_cluster_wakeups = crossClusterWakeups;
+  //every other cycle issued nothing
+  p_stats->issue_width_hist[0] = p_stats->num_cycles;
+  for (int w = 1; w <= MAX_ISSUE_WIDTH; w++) {
+    p_stats->issue_width_hist[0] -= p_stats->issue_width_hist[w];
+  }
+}
+
+/**
+ * Subroutine that sets the options used by the following scheduler_*_init calls on this thread
+ *
+ * @param[in]   p_options       FU classes, renaming and reorder buffer, which must outlive those
+ *                              calls (NULL for the defaults)
+ */
+void scheduler_set_options(const scheduler_options_t* p_options) {
+  instanceOptions = p_options;
+}
+
+/**
+ * Subroutine for initializing the scheduler (unified reservation station type).
+ * You may initalize any global or heap variables as needed.
+ * XXX You're responsible for completing this routine.
+ *
+ * @param[in]   num_registers   The number of registers in the instructions
+ * @param[in]   rs_size         The number of entries for the unified RS
+ */
+void scheduler_unified_init(int num_registers, int rs_size) {
+  delete instance;
+  instance = new Scheduler(num_registers, rs_size, instanceOptions);
+}
+
+/**
+ * Subroutine for initializing the scheduler (per-functional unit reservation station type).
+ * You may initalize any global or heap variables as needed.
+ * XXX You're responsible for completing this routine.
+ *
+ * @param[in]   num_registers   The number of registers in the instructions
+ * @param[in]   rs_sizes        An array of size 3 that contains the number of entries for each
+ *                              op_type (one per FU class with scheduler_set_options)
+ *                              rs_sizes = [4,2,1] means 4 ADD RS, 2 DIV RS, 1 MEM RS
+ */
+void scheduler_per_fu_init(int num_registers, int rs_sizes[]) {
+  delete instance;
+  instance = new Scheduler(num_registers, rs_sizes, instanceOptions);
+}
+
+//the remaining scheduler_* functions forward to this thread's scheduler
+bool scheduler_try_issue(op_type op, int dest, int src1, int src2, scheduler_stats_t* p_stats) {
+  return instance->try_issue(op, dest, src1, src2, p_stats);
+}
+
+int scheduler_try_issue_group(const trace_inst_t insts[], int count, scheduler_stats_t* p_stats) {
+  return instance->try_issue_group(insts, count, p_stats);
+}
+
+void scheduler_step(scheduler_stats_t* p_stats) {
+  instance->step(p_stats);
+}
+
+void scheduler_skip_idle(scheduler_stats_t* p_stats, bool stalled) {
+  instance->skip_idle(p_stats, stalled);
+}
+
+void scheduler_start_ready(scheduler_stats_t* p_stats) {
+  instance->start_ready(p_stats);
+}
+
+void scheduler_clear_completed(scheduler_stats_t* p_stats) {
+  instance->clear_completed(p_stats);
+}
+
+bool scheduler_completed() {
+  //scheduler wasn't set correctly
+  if (instance == NULL) {
+    return false;
+  }
+  return instance->completed();
+}
+
+void scheduler_complete(scheduler_stats_t* p_stats) {
+  instance->complete(p_stats);
+}
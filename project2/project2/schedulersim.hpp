@@ -4,15 +4,27 @@
 #include <cstdint>
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <memory>
 
 const static int INVALID_REG = -1;
 
 enum rs_type {
     RSTYPE_UNIFIED      = 'U',
     RSTYPE_PER_FU       = 'F',
+    RSTYPE_CLUSTERED    = 'C',
 };
 
-enum op_type {
+//how a clustered scheduler picks the cluster of each instruction it issues
+enum steer_policy {
+    STEER_DEPENDENCE    = 0,    //the cluster of an in-flight source's producer, else the emptiest
+    STEER_ROUND_ROBIN   = 1,    //the clusters in turn
+};
+
+//an op_type is an FU class index; the first three are the classes of the default configuration
+enum op_type : int {
     OP_INVALID          = -1,
     OP_ADD              = 0,
     OP_DIV              = 1,
@@ -20,6 +32,87 @@ enum op_type {
     NUM_OPS             = 3,
 };
 
+const static int MAX_FU_CLASSES = 16;
+const static int MAX_ISSUE_WIDTH = 16;
+const static int MAX_TRACE_OPCODES = 64;
+const static int MAX_SMT_THREADS = 8;
+const static int MAX_CLUSTERS = 8;
+const static int MAX_LATENCY_BUCKETS = 64;
+
+enum latency_model_type {
+    LATENCY_FIXED       = 0,    //always the class latency
+    LATENCY_HIT_MISS    = 1,    //a hit or, with some probability, a miss latency
+    LATENCY_HISTOGRAM   = 2,    //sampled from an empirical distribution
+};
+
+//how the latency of an FU class varies from instruction to instruction
+struct fu_latency_model_t {
+    latency_model_type type;
+    int hit_latency;            //LATENCY_HIT_MISS
+    int miss_latency;
+    int miss_percent;
+    int num_buckets;            //LATENCY_HISTOGRAM: latencies and their relative weights
+    int bucket_latency[MAX_LATENCY_BUCKETS];
+    std::uint32_t bucket_weight[MAX_LATENCY_BUCKETS];
+};
+//RS occupancy histograms count every occupancy up to this one exactly, and larger ones together
+const static int MAX_RS_OCCUPANCY_BUCKET = 64;
+
+//a class of functional units and the instructions that run on them
+struct fu_class_t {
+    char name[16];
+    int latency;        //cycles from fire to completion (the rounded mean with a latency model)
+    int units;          //number of units, 0 for unlimited
+    bool pipelined;     //a unit takes a new instruction every cycle, else it is busy until completion
+    int rs_size;        //default per-FU reservation station size
+    fu_latency_model_t latency_model;
+};
+
+//maps an opcode in text traces to an FU class
+struct fu_opcode_t {
+    char name[16];
+    int fu_class;
+};
+
+struct fu_config_t {
+    int num_classes;
+    fu_class_t classes[MAX_FU_CLASSES];
+    int num_opcodes;
+    fu_opcode_t opcodes[MAX_TRACE_OPCODES];
+    std::uint64_t seed;     //seeds the latency models, so runs are repeatable
+};
+
+void fu_config_default(fu_config_t* p_config);
+bool fu_config_load(const char* path, fu_config_t* p_config);
+
+class PipeViewWriter;
+class LatencyModel;
+
+//machine options beyond the reservation stations; the defaults are the original scheduler
+struct scheduler_options_t {
+    const fu_config_t* fu_config;   //FU classes (NULL for the default ADD, DIV and MEM)
+    int num_physical_regs;          //rename onto this many physical registers, 0 to not rename
+    int rob_size;                   //reorder buffer entries, 0 for no reorder buffer
+    int commit_width;               //instructions committed per cycle, 0 for unlimited
+    PipeViewWriter* pipe_view;      //log every instruction's cycles here, NULL for no log
+    int num_threads;                //hardware threads sharing the RS and FUs, each with its own registers
+    int cdb_width;                  //results broadcast per cycle on the result buses, 0 for unlimited
+    int bypass_latency;             //extra cycles from a source's broadcast until its readers can fire
+    int num_clusters;               //clusters the unified RS and the FUs are split into, 1 for none
+    steer_policy steering;          //how issue picks an instruction's cluster
+    int cluster_delay;              //extra cycles for a result to reach readers in another cluster
+};
+
+void scheduler_options_default(scheduler_options_t* p_options);
+
+//one instruction of a trace
+struct trace_inst_t {
+    op_type op;
+    int dest;
+    int src1;
+    int src2;
+};
+
 struct scheduler_stats_t {
     std::uint64_t num_insts;
     std::uint64_t num_cycles;
@@ -27,18 +120,241 @@ struct scheduler_stats_t {
     std::uint64_t issue_stall;
     std::uint32_t max_fired;
     std::uint32_t max_completed;
-    std::uint32_t max_active[NUM_OPS];
+    std::uint32_t max_active[MAX_FU_CLASSES];
+    std::uint64_t issue_width_hist[MAX_ISSUE_WIDTH + 1];   //cycles issuing 0, 1, ... instructions
+    std::uint64_t rs_full_stall;    //issue stalls on a full reservation station
+    std::uint64_t rename_stall;     //issue stalls on an empty physical register free list
+    std::uint64_t raw_wait;         //cycles instructions spent waiting for source operands (renaming)
+    std::uint64_t rob_full_stall;   //issue stalls on a full reorder buffer
+    std::uint64_t rob_occupancy;    //sum over cycles of the reorder buffer entries in use
+    std::uint32_t max_rob_occupancy;
+    std::uint32_t max_committed;
+    //cycles in which nothing fired, by why the next instruction to fire could not
+    std::uint64_t no_fire_empty;    //no unfired instruction
+    std::uint64_t no_fire_raw;      //waiting on a source register
+    std::uint64_t no_fire_waw;      //waiting only on its destination register
+    std::uint64_t no_fire_fu_busy;  //ready, but no free functional unit
+    std::uint64_t num_fired;
+    std::uint64_t fire_wait;        //sum over fired instructions of the cycles from issue to fire
+    //per reservation station (one for unified), cycles spent at each occupancy
+    std::uint64_t rs_occupancy_hist[MAX_FU_CLASSES][MAX_RS_OCCUPANCY_BUCKET + 1];
+    //per hardware thread, instructions issued and the cycle count when its last one finished
+    std::uint64_t thread_insts[MAX_SMT_THREADS];
+    std::uint64_t thread_cycles[MAX_SMT_THREADS];
+    std::uint64_t cdb_delayed;              //instruction-cycles finished instructions waited for a result bus
+    std::uint64_t cdb_contention_cycles;    //cycles in which some finished instruction lost arbitration
+    std::uint64_t cluster_insts[MAX_CLUSTERS];  //instructions steered to each cluster
+    std::uint64_t cross_cluster_wakeups;        //source operands delivered from another cluster
 };
 
+/**
+ * A scheduler simulation. It owns all of its state, so several can be simulated at once (for
+ * example one per thread). The scheduler_* functions below drive one per thread.
+ */
+class Scheduler {
+public:
+    Scheduler(int num_registers, int rs_size, const scheduler_options_t* p_options = NULL);
+    Scheduler(int num_registers, const int rs_sizes[], const scheduler_options_t* p_options = NULL);
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+    ~Scheduler();
+
+    bool try_issue(op_type op, int dest, int src1, int src2, scheduler_stats_t* p_stats, int thread = 0);
+    int try_issue_group(const trace_inst_t insts[], int count, scheduler_stats_t* p_stats, int thread = 0);
+    void step(scheduler_stats_t* p_stats);
+    void skip_idle(scheduler_stats_t* p_stats, bool stalled);
+    void start_ready(scheduler_stats_t* p_stats);
+    void clear_completed(scheduler_stats_t* p_stats);
+    void commit(scheduler_stats_t* p_stats);
+    bool completed() const;
+    void complete(scheduler_stats_t* p_stats);
+    int cycle() const { return current_cycle; }
+    int unfired(int thread) const { return unfiredPerThread[thread]; }
+
+private:
+    //struct tracking important values to each instruction scheduled
+    struct instruction {
+        op_type opcode; //type of instruction
+        int destination; //destination register of instruction
+        int src1; //register 1 of instruction
+        int src2; //register 2 of instruction
+        int latency; //how many cycles the instruction takes once fired
+        int cycleIssued; //what cycle the instruction was issued
+        std::uint64_t issueOrder; //position in issue order, which breaks ties within a cycle
+        int dueCycle; //cycle whose clear first sees the instruction with one cycle left (once fired)
+        int station; //which reservation station holds the instruction
+        int physDest; //physical destination register (renaming only)
+        int physSrc1; //physical register of src1, -1 if unused (renaming only)
+        int physSrc2; //physical register of src2, -1 if unused (renaming only)
+        int robSlot; //reorder buffer entry, -1 without a reorder buffer
+        int cycleFired; //what cycle the instruction fired
+        int thread; //hardware thread that issued it
+    };
+
+    //struct tracking one reorder buffer entry, which outlives the instruction's RS slot
+    struct robEntry {
+        bool done; //the instruction has completed and may commit
+        std::uint64_t issueOrder; //position in issue order of the instruction
+        int thread; //hardware thread that issued it
+        int oldPhys; //physical register its destination mapped to before it (renaming only)
+    };
+
+    //why the last failed issue stalled
+    enum stallCause {
+        STALL_RS_FULL,
+        STALL_RENAME,
+        STALL_ROB_FULL,
+    };
+
+    //struct tracking a reservation station. Its slots are a range of the shared entry pool starting
+    //on a 64-entry word boundary, so its occupancy and ready bits are whole bitmap words
+    struct reservationStation {
+        int maxSize; //max possible size of reservation station
+        int currSize; //current size of reservation station
+        int base; //first entry of the reservation station in the entry pool
+        int numWords; //number of bitmap words covering the reservation station
+        int freeWord; //no word of the reservation station before this one has a free slot
+    };
+
+    void init(int num_registers, const int sizes[], int count, const scheduler_options_t* p_options);
+    bool unitAvailable(int fu_class, int station) const;
+    int steer(int src1, int src2) const;
+    static int operandReg(const instruction &inst, int operand);
+    int waitReg(const instruction &inst, int operand) const;
+    int sourceReg(const instruction &inst, int operand) const;
+    int oldestUnfired(bool ready, bool unit) const;
+    bool headReady() const;
+    bool regBusy(int r) const;
+    void releasePhys(int p);
+    void markReady(int e);
+    void updateMaxActive(scheduler_stats_t* p_stats) const;
+    void countNoFire(scheduler_stats_t* p_stats, std::uint64_t cycles) const;
+    void sampleOccupancy(scheduler_stats_t* p_stats, std::uint64_t cycles) const;
+    void wakeWaiters(int r, int delta, const instruction &writer);
+    void fireInstruction(int e);
+
+    //tracks the current cycle the scheduler is on
+    int current_cycle;
+    //FU classes, their latencies and how many units they have
+    fu_config_t config;
+    //sampler of each FU class with a variable latency, NULL for a fixed one
+    std::unique_ptr<LatencyModel> latencyModels[MAX_FU_CLASSES];
+    //reservation stations, one for unified or one per FU class (indexed by op_type) for perFU
+    reservationStation stations[MAX_FU_CLASSES];
+    //number of reservation stations in use
+    int numStations;
+    //every reservation station slot, station by station
+    std::vector<instruction> entries;
+    //the per-entry fields the wakeup and completion loops touch, kept in parallel arrays beside
+    //entries so those loops stay within a few cache lines: how many of its registers each unfired
+    //instruction waits on (ready to fire at 0), and the order completions are cleared in (station
+    //above issue order)
+    std::vector<int> waitCounts;
+    std::vector<std::uint64_t> clearKeys;
+    //first cycle each ready instruction can fire, once the bypass has delivered its last source
+    std::vector<int> readyCycles;
+    //one bit per entry: slot holds an instruction / unfired and waiting on nothing
+    std::vector<std::uint64_t> occupiedBits;
+    std::vector<std::uint64_t> readyBits;
+    //unfired instructions of each thread in issue order. A thread's instructions fire oldest first
+    //and stop at the first one that collides, so only the heads of these queues are ever candidates
+    std::vector<int> nextUnfired;
+    int unfiredHead[MAX_SMT_THREADS];
+    int unfiredTail[MAX_SMT_THREADS];
+    //hardware threads, whose registers are numRegisters apart in the RAT
+    int numThreads;
+    int numRegisters;
+    int unfiredPerThread[MAX_SMT_THREADS];
+    //wakeup lists: for every register, the unfired instructions naming it (as destination or source).
+    //Each entry has one node per distinct register it names, node = entry * 3 + operand. When
+    //renaming, the registers are physical ones and only sources are waited on
+    std::vector<int> waitHead;
+    std::vector<int> waitNext;
+    std::vector<int> waitPrev;
+    //register alias table: busy bit per architectural register
+    std::vector<int> rat;
+    //true to rename onto physical registers, so only true (RAW) dependencies stall
+    bool renaming;
+    //renaming: architectural register to its current physical register
+    std::vector<int> renameMap;
+    //renaming: per physical register, whether its value has been produced, whether a younger
+    //mapping has replaced it, and how many unfired instructions still read it
+    std::vector<char> physReady;
+    std::vector<char> physSuperseded;
+    std::vector<int> physReaders;
+    //renaming: physical registers that are free to allocate
+    std::vector<int> freePhys;
+    //renaming: (issue order, entry) of every ready unfired instruction. Instructions fire out of
+    //order, oldest ready first
+    std::priority_queue<std::pair<std::uint64_t, int>, std::vector<std::pair<std::uint64_t, int> >, std::greater<std::pair<std::uint64_t, int> > > readyQueue;
+    std::vector<int> deferred;
+    //whether this cycle deferred a ready instruction for want of a unit (not the bypass)
+    bool unitBlocked;
+    //why the last failed issue stalled, which every skipped cycle is charged to
+    stallCause lastStall;
+    //reorder buffer: a ring of robSize entries holding robCount instructions from robHead in issue
+    //order, committed in order up to commitWidth per cycle (0 for unlimited)
+    std::vector<robEntry> rob;
+    int robSize;
+    int robHead;
+    int robCount;
+    int commitWidth;
+    //pipeline log, NULL for none
+    PipeViewWriter* pipeView;
+    //results broadcast per cycle (0 for unlimited) and wakeup-to-fire bypass cycles
+    int cdbWidth;
+    int bypassLatency;
+    //cycles instructions have spent waiting for source operands
+    std::uint64_t rawWaitCycles;
+    //reservation station of each FU class, fixed by the organization when the scheduler is built
+    //(all 0 for unified, the class itself for perFU) so issue never checks the organization
+    int stationOf[MAX_FU_CLASSES];
+    //how many instructions have been issued
+    std::uint64_t numIssued;
+    //how many instructions are in the scheduler across all reservation stations
+    int currPipelineSize;
+    //how many of them have not fired yet
+    int numUnfired;
+    //how many instructions are active perFU
+    int numActive[MAX_FU_CLASSES];
+    //clustered: every reservation station is a cluster with its own units of every FU class, fed
+    //by the steering policy, and a result reaches another cluster's readers clusterDelay cycles late.
+    //Renamed instructions fire oldest ready first within each cluster's units, which is each cluster
+    //selecting on its own; without renaming firing stays in program order across all clusters, so a
+    //blocked instruction in one cluster also holds back the others
+    int numClusters;
+    steer_policy steering;
+    int clusterDelay;
+    int nextCluster;
+    //cluster of each reservation station, fixed when the scheduler is built (all 0 unless clustered)
+    //so the units and wakeups never check the organization
+    int clusterOf[MAX_FU_CLASSES];
+    //per cluster and FU class, how many instructions are active / were fired this cycle
+    int clusterActive[MAX_CLUSTERS][MAX_FU_CLASSES];
+    int clusterFired[MAX_CLUSTERS][MAX_FU_CLASSES];
+    //per register (physical when renaming), the cluster and issue order of its last writer, cluster
+    //-1 once that has produced its value
+    std::vector<int> producerCluster;
+    std::vector<std::uint64_t> producerOrder;
+    //per entry, the issue order of the writer each of its two sources reads (NO_PRODUCER for none)
+    std::vector<std::uint64_t> sourceProducers;
+    std::uint64_t crossClusterWakeups;
+    //min-heap of (due cycle, entry), one per active instruction
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int> >, std::greater<std::pair<int, int> > > dueCycles;
+    //(clear key, entry) of the instructions due in the clear being processed
+    std::vector<std::pair<std::uint64_t, int> > candidates;
+};
+
+void scheduler_set_options(const scheduler_options_t* p_options);
 void scheduler_unified_init(int num_registers, int rs_size);
 void scheduler_per_fu_init(int num_registers, int rs_sizes[]);
 bool scheduler_try_issue(op_type op, int dest, int src1, int src2, scheduler_stats_t* p_stats);
+int scheduler_try_issue_group(const trace_inst_t insts[], int count, scheduler_stats_t* p_stats);
 void scheduler_step(scheduler_stats_t* p_stats);
+void scheduler_skip_idle(scheduler_stats_t* p_stats, bool stalled);
 void scheduler_start_ready(scheduler_stats_t* p_stats);
 void scheduler_clear_completed(scheduler_stats_t* p_stats);
 bool scheduler_completed();
 void scheduler_complete(scheduler_stats_t* p_stats);
 
-extern int current_cycle;
-
 #endif /* BRANCHSIM_HPP */
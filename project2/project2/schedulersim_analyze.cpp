@@ -0,0 +1,52 @@
+#include <cstdio>
+#include <cinttypes>
+#include <cstdlib>
+#include <unistd.h>
+#include "schedulersim_trace.hpp"
+#include "schedulersim_dataflow.hpp"
+
+void print_help_and_exit() {
+    printf("schedulersim_analyze [OPTIONS] < traces/file.trc\n");
+    printf("  -c [FILE]\tTake FU latencies and text opcodes from an FU configuration\n");
+    printf("  -h\t\tThis helpful output\n");
+    printf("Reads a text or binary trace once and prints its dataflow critical path, the IPC with\n");
+    printf("unlimited resources, its op mix and how far back each source's producer is.\n");
+
+    exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    const char* config_path = NULL;
+
+    // Process arguments
+    while(-1 != (opt = getopt(argc, argv, "c:h"))) {
+        switch(opt) {
+        case 'c':
+            config_path = optarg;
+            break;
+        case 'h':
+            // Fall through
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    fu_config_t config;
+    if (config_path == NULL) {
+        fu_config_default(&config);
+    } else if (!fu_config_load(config_path, &config)) {
+        return 1;
+    }
+    TraceReader reader(STDIN_FILENO, &config);
+    DataflowAnalyzer analyzer(&config);
+    trace_inst_t inst;
+    while (reader.next(&inst)) {
+        analyzer.add(inst);
+    }
+    const dataflow_stats_t& stats = analyzer.stats();
+    printf("# Insts: %" PRIu64 "\n", stats.num_insts);
+    print_dataflow_stats(stdout, &stats, &config);
+    return 0;
+}
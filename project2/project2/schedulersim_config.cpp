@@ -0,0 +1,218 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "schedulersim.hpp"
+
+/**
+ * Subroutine that fills in the default FU configuration: unlimited pipelined ADD, DIV and MEM
+ * units taking 2, 15 and 20 cycles, each run by the trace opcode of the same name
+ *
+ * @param[out]  p_config        The FU configuration
+ */
+void fu_config_default(fu_config_t* p_config) {
+    const char* names[] = {"ADD", "DIV", "MEM"};
+    const int latencies[] = {2, 15, 20};
+    const int rs_sizes[] = {4, 4, 2};
+    std::memset(p_config, 0, sizeof(fu_config_t));
+    for (int op = 0; op < NUM_OPS; op++) {
+        fu_class_t& fu = p_config->classes[op];
+        std::strcpy(fu.name, names[op]);
+        fu.latency = latencies[op];
+        fu.units = 0;
+        fu.pipelined = true;
+        fu.rs_size = rs_sizes[op];
+        std::strcpy(p_config->opcodes[op].name, names[op]);
+        p_config->opcodes[op].fu_class = op;
+    }
+    p_config->num_classes = NUM_OPS;
+    p_config->num_opcodes = NUM_OPS;
+    p_config->seed = 1;
+}
+
+//returns the index of the FU class with a name, or -1
+static int find_class(const fu_config_t* p_config, const char* name) {
+    for (int c = 0; c < p_config->num_classes; c++) {
+        if (std::strcmp(p_config->classes[c].name, name) == 0) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Subroutine that reads a latency histogram: "LATENCY WEIGHT" lines ('#' starts a comment), with
+ * the weights relative to each other
+ *
+ * @param[in]   path            The histogram file
+ * @param[out]  p_model         The latency model, whose buckets are filled in
+ *
+ * @return                      false (after printing the offending line) on an error
+ */
+static bool load_histogram(const char* path, fu_latency_model_t* p_model) {
+    std::FILE* fp = std::fopen(path, "r");
+    if (fp == NULL) {
+        std::printf("Could not open %s\n", path);
+        return false;
+    }
+    char line[256];
+    int line_number = 0;
+    bool ok = true;
+    p_model->num_buckets = 0;
+    while (ok && std::fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        char* comment = std::strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        char first[16];
+        int latency = 0;
+        unsigned int weight = 0;
+        if (std::sscanf(line, "%15s", first) != 1) {
+            continue;
+        } else if (std::sscanf(line, "%d %u", &latency, &weight) == 2 && latency > 0
+                   && p_model->num_buckets < MAX_LATENCY_BUCKETS) {
+            p_model->bucket_latency[p_model->num_buckets] = latency;
+            p_model->bucket_weight[p_model->num_buckets] = weight;
+            p_model->num_buckets++;
+        } else {
+            std::printf("%s:%d: malformed line\n", path, line_number);
+            ok = false;
+        }
+    }
+    std::fclose(fp);
+    std::uint64_t total = 0;
+    for (int b = 0; b < p_model->num_buckets; b++) {
+        total += p_model->bucket_weight[b];
+    }
+    if (ok && total == 0) {
+        std::printf("%s: no latencies with a weight\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+//returns the latency model's mean rounded to whole cycles, which stands in for it where one number is needed
+static int mean_latency(const fu_latency_model_t& model) {
+    if (model.type == LATENCY_HIT_MISS) {
+        return (model.hit_latency * (100 - model.miss_percent) + model.miss_latency * model.miss_percent + 50) / 100;
+    }
+    std::uint64_t total = 0;
+    std::uint64_t sum = 0;
+    for (int b = 0; b < model.num_buckets; b++) {
+        total += model.bucket_weight[b];
+        sum += (std::uint64_t)model.bucket_weight[b] * model.bucket_latency[b];
+    }
+    return (int)((sum + total / 2) / total);
+}
+
+/**
+ * Subroutine that reads an FU configuration. Lines ('#' starts a comment) are
+ *   class NAME LATENCY [UNITS [PIPELINED [RS_SIZE]]]
+ *   op OPCODE CLASS
+ *   latency CLASS hitmiss HIT_LATENCY MISS_LATENCY MISS_PERCENT
+ *   latency CLASS histogram FILE
+ *   seed SEED
+ * UNITS 0 (the default) is unlimited, PIPELINED is 1 (the default) or 0, and RS_SIZE is the default
+ * per-FU reservation station size. Classes are numbered in file order, which is also the opcode
+ * numbering of binary traces. Without any op lines every class runs the opcode of its own name.
+ * A latency line replaces the fixed latency of a class with one drawn per instruction, either a hit
+ * or (MISS_PERCENT of the time) a miss, or from the histogram FILE (relative to the configuration's
+ * directory); the class latency becomes the rounded mean. SEED (1 by default) seeds the draws.
+ *
+ * @param[in]   path            The configuration file
+ * @param[out]  p_config        The FU configuration
+ *
+ * @return                      false (after printing the offending line) on an error
+ */
+bool fu_config_load(const char* path, fu_config_t* p_config) {
+    std::FILE* fp = std::fopen(path, "r");
+    if (fp == NULL) {
+        std::printf("Could not open %s\n", path);
+        return false;
+    }
+    std::memset(p_config, 0, sizeof(fu_config_t));
+    p_config->seed = 1;
+    std::string directory(path);
+    directory.erase(directory.find_last_of('/') + 1);
+    char line[256];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && std::fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        char* comment = std::strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        char kind[16];
+        char name[16];
+        char target[16];
+        char file[200];
+        unsigned long long seed = 0;
+        int latency = 0;
+        int units = 0;
+        int pipelined = 1;
+        int rs_size = 4;
+        if (std::sscanf(line, "%15s", kind) != 1) {
+            continue;
+        } else if (std::strcmp(kind, "class") == 0
+                   && std::sscanf(line, "%*s %15s %d %d %d %d", name, &latency, &units, &pipelined, &rs_size) >= 2
+                   && latency > 0 && units >= 0 && rs_size >= 0 && p_config->num_classes < MAX_FU_CLASSES
+                   && find_class(p_config, name) == -1) {
+            fu_class_t& fu = p_config->classes[p_config->num_classes++];
+            std::strcpy(fu.name, name);
+            fu.latency = latency;
+            fu.units = units;
+            fu.pipelined = pipelined != 0;
+            fu.rs_size = rs_size;
+        } else if (std::strcmp(kind, "op") == 0 && std::sscanf(line, "%*s %15s %15s", name, target) == 2
+                   && find_class(p_config, target) != -1 && p_config->num_opcodes < MAX_TRACE_OPCODES) {
+            fu_opcode_t& opcode = p_config->opcodes[p_config->num_opcodes++];
+            std::strcpy(opcode.name, name);
+            opcode.fu_class = find_class(p_config, target);
+        } else if (std::strcmp(kind, "latency") == 0
+                   && std::sscanf(line, "%*s %15s %15s", name, target) == 2 && find_class(p_config, name) != -1) {
+            fu_class_t& fu = p_config->classes[find_class(p_config, name)];
+            fu_latency_model_t& model = fu.latency_model;
+            if (std::strcmp(target, "hitmiss") == 0
+                && std::sscanf(line, "%*s %*s %*s %d %d %d", &model.hit_latency, &model.miss_latency,
+                               &model.miss_percent) == 3
+                && model.hit_latency > 0 && model.miss_latency > 0
+                && model.miss_percent >= 0 && model.miss_percent <= 100) {
+                model.type = LATENCY_HIT_MISS;
+            } else if (std::strcmp(target, "histogram") == 0 && std::sscanf(line, "%*s %*s %*s %199s", file) == 1) {
+                std::string file_path = file[0] == '/' ? std::string(file) : directory + file;
+                if (!load_histogram(file_path.c_str(), &model)) {
+                    ok = false;
+                    continue;
+                }
+                model.type = LATENCY_HISTOGRAM;
+            } else {
+                std::printf("%s:%d: malformed line\n", path, line_number);
+                ok = false;
+                continue;
+            }
+            fu.latency = mean_latency(model);
+            if (fu.latency < 1) {
+                fu.latency = 1;
+            }
+        } else if (std::strcmp(kind, "seed") == 0 && std::sscanf(line, "%*s %llu", &seed) == 1) {
+            p_config->seed = seed;
+        } else {
+            std::printf("%s:%d: malformed line\n", path, line_number);
+            ok = false;
+        }
+    }
+    std::fclose(fp);
+    if (ok && p_config->num_classes == 0) {
+        std::printf("%s: no FU classes\n", path);
+        ok = false;
+    }
+    if (ok && p_config->num_opcodes == 0) {
+        for (int c = 0; c < p_config->num_classes; c++) {
+            std::strcpy(p_config->opcodes[c].name, p_config->classes[c].name);
+            p_config->opcodes[c].fu_class = c;
+        }
+        p_config->num_opcodes = p_config->num_classes;
+    }
+    return ok;
+}
@@ -0,0 +1,75 @@
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "schedulersim_trace.hpp"
+
+void print_help_and_exit() {
+    printf("schedulersim_convert [OPTIONS] < traces/file.trc > traces/file.btrc\n");
+    printf("  -t\t\tWrite a text trace instead of a binary one\n");
+    printf("  -c [FILE]\tMap text opcodes to FU classes with an FU configuration\n");
+    printf("  -h\t\tThis helpful output\n");
+    printf("Reads a text or binary trace and rewrites it in the other (or the same) format.\n");
+    printf("Binary traces hold registers 0-254 only.\n");
+
+    exit(0);
+}
+
+/**
+ * Returns the first trace opcode of the configuration that runs on an FU class, so a text trace
+ * written with it reads back as the same class, or "???" if none does.
+ */
+const char* opcode_name(const fu_config_t& config, op_type op) {
+    for (int i = 0; i < config.num_opcodes; i++) {
+        if (config.opcodes[i].fu_class == op) {
+            return config.opcodes[i].name;
+        }
+    }
+    return "???";
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    bool text = false;
+    const char* config_path = NULL;
+
+    // Process arguments
+    while(-1 != (opt = getopt(argc, argv, "tc:h"))) {
+        switch(opt) {
+        case 't':
+            text = true;
+            break;
+        case 'c':
+            config_path = optarg;
+            break;
+        case 'h':
+            // Fall through
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    fu_config_t config;
+    if (config_path == NULL) {
+        fu_config_default(&config);
+    } else if (!fu_config_load(config_path, &config)) {
+        return 1;
+    }
+    TraceReader reader(STDIN_FILENO, &config);
+    if (!text && fwrite(TRACE_BINARY_MAGIC, 1, sizeof(TRACE_BINARY_MAGIC), stdout) != sizeof(TRACE_BINARY_MAGIC)) {
+        fprintf(stderr, "Write failed\n");
+        return 1;
+    }
+    trace_inst_t inst;
+    unsigned long line = 0;
+    while (reader.next(&inst)) {
+        line++;
+        if (text) {
+            printf("%s %d %d %d\n", opcode_name(config, inst.op), inst.dest, inst.src1, inst.src2);
+        } else if (!write_trace_record(stdout, inst)) {
+            fprintf(stderr, "Instruction %lu: register out of range or write failed\n", line);
+            return 1;
+        }
+    }
+    return 0;
+}
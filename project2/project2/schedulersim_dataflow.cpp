@@ -0,0 +1,104 @@
+#include <cinttypes>
+#include <cstring>
+#include "schedulersim_dataflow.hpp"
+
+DataflowAnalyzer::DataflowAnalyzer(const fu_config_t* p_config) {
+    if (p_config != NULL) {
+        config = *p_config;
+    } else {
+        fu_config_default(&config);
+    }
+    std::memset(&results, 0, sizeof(results));
+}
+
+//makes room for a register number
+void DataflowAnalyzer::grow(int reg) {
+    if (reg >= (int)readyCycle.size()) {
+        readyCycle.resize(reg + 1, 0);
+        producer.resize(reg + 1, -1);
+    }
+}
+
+/**
+ * Subroutine that adds the next instruction of the trace
+ *
+ * @param[in]   inst        The instruction
+ */
+void DataflowAnalyzer::add(const trace_inst_t& inst) {
+    std::int64_t index = results.num_insts++;
+    if (inst.op < 0 || inst.op >= config.num_classes || inst.dest < 0) {
+        results.invalid_insts++;
+        return;
+    }
+    results.op_mix[inst.op]++;
+    //it starts once the later of its sources is produced
+    std::uint64_t start = 0;
+    int srcs[] = {inst.src1, inst.src2};
+    for (int k = 0; k < 2; k++) {
+        if (srcs[k] < 0) {
+            continue;
+        }
+        grow(srcs[k]);
+        if (producer[srcs[k]] == -1) {
+            results.no_producer++;
+            continue;
+        }
+        std::uint64_t distance = index - producer[srcs[k]];
+        int bucket = 63 - __builtin_clzll(distance);
+        results.dep_distance_hist[bucket < NUM_DEP_DISTANCE_BUCKETS ? bucket : NUM_DEP_DISTANCE_BUCKETS - 1]++;
+        if (readyCycle[srcs[k]] > start) {
+            start = readyCycle[srcs[k]];
+        }
+    }
+    //its destination is a fresh value, so earlier readers and writers of it never hold it back
+    grow(inst.dest);
+    readyCycle[inst.dest] = start + config.classes[inst.op].latency;
+    producer[inst.dest] = index;
+    if (readyCycle[inst.dest] > results.critical_path) {
+        results.critical_path = readyCycle[inst.dest];
+    }
+}
+
+/**
+ * Subroutine that returns the results for the instructions added so far
+ */
+const dataflow_stats_t& DataflowAnalyzer::stats() {
+    results.ideal_ipc = results.critical_path ? (double)results.num_insts / results.critical_path : 0.0;
+    return results;
+}
+
+/**
+ * Subroutine that prints the results of a dataflow analysis
+ *
+ * @param[in]   fp          Where to print them
+ * @param[in]   p_stats     The results
+ * @param[in]   p_config    The FU configuration they were worked out with
+ */
+void print_dataflow_stats(std::FILE* fp, const dataflow_stats_t* p_stats, const fu_config_t* p_config) {
+    std::fprintf(fp, "Dataflow Limit\n");
+    std::fprintf(fp, "# Critical Path: %" PRIu64 " cycles\n", p_stats->critical_path);
+    std::fprintf(fp, "# Ideal IPC: %f\n", p_stats->ideal_ipc);
+    std::fprintf(fp, "Op Mix\n");
+    for (int c = 0; c < p_config->num_classes; c++) {
+        std::fprintf(fp, "# %s: %" PRIu64 " (%.2f%%)\n", p_config->classes[c].name, p_stats->op_mix[c],
+                     p_stats->num_insts ? 100.0 * p_stats->op_mix[c] / p_stats->num_insts : 0.0);
+    }
+    if (p_stats->invalid_insts > 0) {
+        std::fprintf(fp, "# Invalid: %" PRIu64 "\n", p_stats->invalid_insts);
+    }
+    std::fprintf(fp, "Dependency Distance\n");
+    for (int b = 0; b < NUM_DEP_DISTANCE_BUCKETS; b++) {
+        if (p_stats->dep_distance_hist[b] == 0) {
+            continue;
+        }
+        std::uint64_t low = (std::uint64_t)1 << b;
+        if (b == NUM_DEP_DISTANCE_BUCKETS - 1) {
+            std::fprintf(fp, "# %" PRIu64 "+: %" PRIu64 "\n", low, p_stats->dep_distance_hist[b]);
+        } else if (low == 1) {
+            std::fprintf(fp, "# 1: %" PRIu64 "\n", p_stats->dep_distance_hist[b]);
+        } else {
+            std::fprintf(fp, "# %" PRIu64 "-%" PRIu64 ": %" PRIu64 "\n", low, 2 * low - 1, p_stats->dep_distance_hist[b]);
+        }
+    }
+    std::fprintf(fp, "# No Producer: %" PRIu64 "\n", p_stats->no_producer);
+}
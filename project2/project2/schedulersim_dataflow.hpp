@@ -0,0 +1,46 @@
+#ifndef SCHEDULERSIM_DATAFLOW_HPP
+#define SCHEDULERSIM_DATAFLOW_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "schedulersim.hpp"
+
+//dependency distances are counted in power-of-two buckets: 1, 2-3, 4-7, ... and this many or more
+const static int NUM_DEP_DISTANCE_BUCKETS = 17;
+
+struct dataflow_stats_t {
+    std::uint64_t num_insts;
+    std::uint64_t invalid_insts;    //opcode not in the FU configuration, left out of the dataflow
+    std::uint64_t critical_path;    //cycles until the last value is produced with unlimited resources
+    double        ideal_ipc;
+    std::uint64_t op_mix[MAX_FU_CLASSES];
+    std::uint64_t dep_distance_hist[NUM_DEP_DISTANCE_BUCKETS];  //instructions back to each source's producer
+    std::uint64_t no_producer;      //sources written by no earlier instruction of the trace
+};
+
+/**
+ * Works out the dataflow limit of a trace in one pass: every instruction starts as soon as its
+ * sources are produced and takes its FU class latency, with unlimited reservation stations, units
+ * and registers (so only true dependencies order instructions) and everything issued at once.
+ */
+class DataflowAnalyzer {
+public:
+    explicit DataflowAnalyzer(const fu_config_t* p_config = NULL);
+
+    void add(const trace_inst_t& inst);
+    const dataflow_stats_t& stats();
+
+private:
+    void grow(int reg);
+
+    fu_config_t config;
+    dataflow_stats_t results;
+    //per register, the cycle its latest value is produced and the instruction producing it (-1 for none)
+    std::vector<std::uint64_t> readyCycle;
+    std::vector<std::int64_t> producer;
+};
+
+void print_dataflow_stats(std::FILE* fp, const dataflow_stats_t* p_stats, const fu_config_t* p_config);
+
+#endif /* SCHEDULERSIM_DATAFLOW_HPP */
@@ -2,51 +2,242 @@
 #include <cinttypes>
 #include <cstdlib>
 #include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <fcntl.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include <unistd.h>
-#include "schedulersim.hpp"
+#include "schedulersim_trace.hpp"
+#include "schedulersim_pipeview.hpp"
+#include "schedulersim_dataflow.hpp"
 
 int lineCounter = 1;
+//how many instructions the driver tries to issue per cycle
+int issue_width = 1;
+
+//FU classes, latencies and trace opcodes
+fu_config_t fu_config;
+//FU classes, renaming and reorder buffer for every scheduler
+scheduler_options_t sched_options;
+//print the stall causes, RS occupancy and fire wait as well
+bool verbose_stats = false;
+//SMT issue policy: favour the thread with the fewest unfired instructions, else round-robin
+bool icount_policy = false;
+
+//an inclusive range of values for one option, a single value has start == end
+struct sweep_range_t {
+    int start;
+    int end;
+    int step;
+};
+
+//one configuration of a sweep and its results
+struct sweep_job_t {
+    rs_type rs;
+    int num_registers;
+    int num_physical_regs;
+    int rob_size;
+    int rs_size;
+    int rs_sizes[MAX_FU_CLASSES];
+    int width;
+    scheduler_stats_t stats;
+};
 
 void print_help_and_exit() {
     printf("schedulersim [OPTIONS] < traces/file.trace\n");
+    printf("schedulersim [OPTIONS] traces/file1.trace traces/file2.trace ...\n");
+    printf("  (text traces or binary ones made by schedulersim_convert)\n");
+    printf("  Traces named on the command line run as SMT hardware threads (up to %d), each with its\n", MAX_SMT_THREADS);
+    printf("  own registers, sharing the reservation stations and FUs\n");
     printf("  -r [NUM_REGS]\tNumber of registers in the trace file\n");
     printf("  -u [RS_SIZE]\tUse Unified RS, and set the size\n");
     printf("  -a [RS_SIZE]\tSet the size of the ADD RS\n");
     printf("  -d [RS_SIZE]\tSet the size of the DIV RS\n");
     printf("  -m [RS_SIZE]\tSet the size of the MEM RS\n");
+    printf("  -C [CLUSTERS]\tSplit the unified RS (-u entries each) and the FUs (the configured units\n");
+    printf("    \t\t\teach) into 2 to %d clusters. Each cluster selects on its own only with -p,\n", MAX_CLUSTERS);
+    printf("    \t\t\twithout it instructions still fire in program order across clusters\n");
+    printf("  -S [POLICY]\tCluster steering: dep (follow an in-flight source's producer, else the\n");
+    printf("    \t\t\temptiest cluster; default) or rr (round-robin)\n");
+    printf("  -X [CYCLES]\tExtra cycles for a result to reach another cluster (default: 1)\n");
+    printf("  -w [WIDTH]\tIssue up to WIDTH instructions per cycle (default: 1, max: %d)\n", MAX_ISSUE_WIDTH);
+    printf("  -p [NUM_PHYS]\tRename onto NUM_PHYS physical registers (more than NUM_REGS), so only\n");
+    printf("    \t\t\ttrue dependencies stall and instructions fire oldest ready first\n");
+    printf("  -b [ROB_SIZE]\tAdd a reorder buffer of ROB_SIZE entries, committed in order\n");
+    printf("  -k [WIDTH]\tCommit up to WIDTH instructions per cycle (default: unlimited)\n");
+    printf("  -R [WIDTH]\tBroadcast at most WIDTH results per cycle, delaying the rest (default: unlimited)\n");
+    printf("  -l [CYCLES]\tExtra bypass cycles from a result's broadcast until its readers can fire\n");
+    printf("  -v\t\t\tAlso print why cycles fired nothing, RS occupancy, issue-to-fire wait and\n");
+    printf("    \t\t\tthe trace's dataflow limit (see schedulersim_analyze)\n");
+    printf("  -o [FILE]\tAlso write every statistic to FILE as CSV\n");
+    printf("  -t [FILE]\tWrite every instruction's issue, fire, complete and commit cycles to FILE\n");
+    printf("    \t\t\tas an O3PipeView log for pipeline viewers such as Konata\n");
+    printf("  -i [POLICY]\tSMT issue policy: rr (round-robin, default) or icount (fewest unfired first)\n");
+    printf("  -c [FILE]\tLoad FU classes, unit counts, latencies and trace opcodes from FILE\n");
+    printf("    \t\t\t(-a, -d and -m then size the RS of its first three classes)\n");
+    printf("  -s\t\t\tSweep mode: -r, -p, -b, -u, -a, -d, -m and -w take START[:END[:STEP]] and every\n");
+    printf("    \t\t\tcombination is simulated, printing a CSV line per configuration\n");
+    printf("  -j [THREADS]\tNumber of worker threads in sweep mode (default: all cores)\n");
     printf("  -h\t\t\tThis helpful output\n");
 
     exit(0);
 }
 
-void print_statistics(scheduler_stats_t* p_stats);
-bool process_trace(op_type* p_op, int* p_dest, int* p_src1, int* p_src2);
+void print_statistics(scheduler_stats_t* p_stats, rs_type rs);
+bool write_statistics_csv(const char* path, const scheduler_stats_t* p_stats, rs_type rs);
+bool simulate_smt(rs_type rs, int num_registers, int rs_size, const int rs_sizes[], char* const paths[],
+                  int num_traces, scheduler_stats_t* p_stats);
+bool parse_range(const char* arg, sweep_range_t* p_range);
+int run_sweep(rs_type rs, const sweep_range_t& regs, const sweep_range_t& phys, const sweep_range_t& robs,
+              const sweep_range_t& unified, const sweep_range_t sizes[], const sweep_range_t& widths,
+              unsigned num_threads);
 
 int main(int argc, char* argv[]) {
     int opt;
     int num_registers = 32;
-    int rs_sizes[] = {4, 4, 2};
+    int num_physical_regs = 0;
+    int rob_size = 0;
+    int commit_width = 0;
+    int cdb_width = 0;
+    int bypass_latency = 0;
+    int num_clusters = 0;
+    steer_policy steering = STEER_DEPENDENCE;
+    int cluster_delay = 1;
+    int rs_sizes[MAX_FU_CLASSES];
     int rs_size = 4;
+    const char* config_path = NULL;
+    const char* csv_path = NULL;
+    const char* pipe_view_path = NULL;
     rs_type rs = RSTYPE_PER_FU;
+    bool sweep = false;
+    unsigned num_threads = std::thread::hardware_concurrency();
+    sweep_range_t regs_range = {num_registers, num_registers, 1};
+    sweep_range_t phys_range = {num_physical_regs, num_physical_regs, 1};
+    sweep_range_t rob_range = {rob_size, rob_size, 1};
+    sweep_range_t rs_range = {rs_size, rs_size, 1};
+    sweep_range_t width_range = {issue_width, issue_width, 1};
+    sweep_range_t rs_ranges[MAX_FU_CLASSES];
+    bool rs_given[MAX_FU_CLASSES] = {false};
 
     // Process arguments
-    while(-1 != (opt = getopt(argc, argv, "r:u:a:d:m:h"))) {
+    while(-1 != (opt = getopt(argc, argv, "r:p:b:k:u:a:d:m:C:S:X:w:R:l:vo:t:i:c:sj:h"))) {
         switch(opt) {
         case 'r':
             num_registers = atoi(optarg);
+            if (!parse_range(optarg, &regs_range)) {
+                print_help_and_exit();
+            }
+            break;
+        case 'p':
+            num_physical_regs = atoi(optarg);
+            if (!parse_range(optarg, &phys_range) || phys_range.start < 0) {
+                print_help_and_exit();
+            }
+            break;
+        case 'b':
+            rob_size = atoi(optarg);
+            if (!parse_range(optarg, &rob_range) || rob_range.start < 0) {
+                print_help_and_exit();
+            }
+            break;
+        case 'k':
+            commit_width = atoi(optarg);
+            if (commit_width < 0) {
+                print_help_and_exit();
+            }
             break;
         case 'a':
-            rs_sizes[OP_ADD] = atoi(optarg);
+            rs_given[OP_ADD] = true;
+            if (!parse_range(optarg, &rs_ranges[OP_ADD])) {
+                print_help_and_exit();
+            }
             break;
         case 'd':
-            rs_sizes[OP_DIV] = atoi(optarg);
+            rs_given[OP_DIV] = true;
+            if (!parse_range(optarg, &rs_ranges[OP_DIV])) {
+                print_help_and_exit();
+            }
             break;
         case 'm':
-            rs_sizes[OP_MEM] = atoi(optarg);
+            rs_given[OP_MEM] = true;
+            if (!parse_range(optarg, &rs_ranges[OP_MEM])) {
+                print_help_and_exit();
+            }
             break;
         case 'u':
             rs = RSTYPE_UNIFIED;
             rs_size = atoi(optarg);
+            if (!parse_range(optarg, &rs_range)) {
+                print_help_and_exit();
+            }
+            break;
+        case 'C':
+            num_clusters = atoi(optarg);
+            if (num_clusters < 2 || num_clusters > MAX_CLUSTERS) {
+                print_help_and_exit();
+            }
+            break;
+        case 'S':
+            if (strcmp(optarg, "dep") == 0) {
+                steering = STEER_DEPENDENCE;
+            } else if (strcmp(optarg, "rr") == 0) {
+                steering = STEER_ROUND_ROBIN;
+            } else {
+                print_help_and_exit();
+            }
+            break;
+        case 'X':
+            cluster_delay = atoi(optarg);
+            if (cluster_delay < 0) {
+                print_help_and_exit();
+            }
+            break;
+        case 'w':
+            issue_width = atoi(optarg);
+            if (!parse_range(optarg, &width_range) || width_range.start < 1 || width_range.end > MAX_ISSUE_WIDTH) {
+                print_help_and_exit();
+            }
+            break;
+        case 'R':
+            cdb_width = atoi(optarg);
+            if (cdb_width < 0) {
+                print_help_and_exit();
+            }
+            break;
+        case 'l':
+            bypass_latency = atoi(optarg);
+            if (bypass_latency < 0) {
+                print_help_and_exit();
+            }
+            break;
+        case 'v':
+            verbose_stats = true;
+            break;
+        case 'o':
+            csv_path = optarg;
+            break;
+        case 't':
+            pipe_view_path = optarg;
+            break;
+        case 'i':
+            if (strcmp(optarg, "icount") == 0) {
+                icount_policy = true;
+            } else if (strcmp(optarg, "rr") == 0) {
+                icount_policy = false;
+            } else {
+                print_help_and_exit();
+            }
+            break;
+        case 'c':
+            config_path = optarg;
+            break;
+        case 's':
+            sweep = true;
+            break;
+        case 'j':
+            num_threads = atoi(optarg);
             break;
         case 'h':
             // Fall through
@@ -56,83 +247,545 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Clusters are unified reservation stations of -u entries each
+    if (num_clusters > 0) {
+        rs = RSTYPE_CLUSTERED;
+    }
+    if (config_path == NULL) {
+        fu_config_default(&fu_config);
+    } else if (!fu_config_load(config_path, &fu_config)) {
+        return 1;
+    }
+    // Classes not sized on the command line use their configured RS size
+    for (int c = 0; c < fu_config.num_classes; c++) {
+        if (!rs_given[c]) {
+            rs_ranges[c].start = rs_ranges[c].end = fu_config.classes[c].rs_size;
+            rs_ranges[c].step = 1;
+        }
+        rs_sizes[c] = rs_ranges[c].start;
+    }
+    // 0 turns renaming off, any other physical register count must exceed every register count
+    int min_phys = (phys_range.start != 0) ? phys_range.start : phys_range.start + phys_range.step;
+    if (min_phys <= phys_range.end && min_phys <= regs_range.end) {
+        printf("Need more physical registers (-p) than registers (-r)\n");
+        return 1;
+    }
+    scheduler_options_default(&sched_options);
+    sched_options.fu_config = &fu_config;
+    sched_options.num_physical_regs = num_physical_regs;
+    sched_options.rob_size = rob_size;
+    sched_options.commit_width = commit_width;
+    sched_options.cdb_width = cdb_width;
+    sched_options.bypass_latency = bypass_latency;
+    if (rs == RSTYPE_CLUSTERED) {
+        sched_options.num_clusters = num_clusters;
+        sched_options.steering = steering;
+        sched_options.cluster_delay = cluster_delay;
+    }
+    scheduler_set_options(&sched_options);
+
+    int num_traces = argc - optind;
+    if (num_traces > MAX_SMT_THREADS || (num_traces > 0 && sweep)) {
+        print_help_and_exit();
+    }
+
+    if (sweep) {
+        return run_sweep(rs, regs_range, phys_range, rob_range, rs_range, rs_ranges, width_range,
+                         num_threads == 0 ? 1 : num_threads);
+    }
+
     printf("Scheduler Settings\n");
     printf("Scheduler Type: %c\n", static_cast<char>(rs));
     printf("# Registers: %d\n", num_registers);
+    if(num_physical_regs > 0) {
+        printf("# Physical Registers: %d\n", num_physical_regs);
+    }
+    if(issue_width > 1) {
+        printf("Issue Width: %d\n", issue_width);
+    }
+    if(cdb_width > 0) {
+        printf("Result Buses: %d\n", cdb_width);
+    }
+    if(bypass_latency > 0) {
+        printf("Bypass Latency: %d\n", bypass_latency);
+    }
+    for(int c = 0; c < fu_config.num_classes; c++) {
+        const fu_latency_model_t& model = fu_config.classes[c].latency_model;
+        if(model.type == LATENCY_HIT_MISS) {
+            printf("%s Latency: %d hit, %d miss (%d%%), seed %llu\n", fu_config.classes[c].name, model.hit_latency,
+                   model.miss_latency, model.miss_percent, (unsigned long long)fu_config.seed);
+        } else if(model.type == LATENCY_HISTOGRAM) {
+            printf("%s Latency: histogram of %d latencies (mean %d), seed %llu\n", fu_config.classes[c].name,
+                   model.num_buckets, fu_config.classes[c].latency, (unsigned long long)fu_config.seed);
+        }
+    }
+    if(num_traces > 0) {
+        printf("SMT Threads: %d (%s)\n", num_traces, icount_policy ? "ICOUNT" : "round-robin");
+    }
+    if(rob_size > 0) {
+        printf("ROB: %d entries\n", rob_size);
+        if(commit_width > 0) {
+            printf("Commit Width: %d\n", commit_width);
+        }
+    }
     if(rs == RSTYPE_UNIFIED) {
         printf("Reservation Station: %d entries\n", rs_size);
+    } else if(rs == RSTYPE_CLUSTERED) {
+        printf("Clusters: %d (%s steering, %d-cycle inter-cluster delay)\n", num_clusters,
+               steering == STEER_ROUND_ROBIN ? "round-robin" : "dependence-based", cluster_delay);
+        printf("Reservation Station: %d entries per cluster\n", rs_size);
     } else {
-        printf("Reservation Station ADD: %d entries\n", rs_sizes[OP_ADD]);
-        printf("Reservation Station DIV: %d entries\n", rs_sizes[OP_DIV]);
-        printf("Reservation Station MEM: %d entries\n", rs_sizes[OP_MEM]);
+        for (int c = 0; c < fu_config.num_classes; c++) {
+            printf("Reservation Station %s: %d entries\n", fu_config.classes[c].name, rs_sizes[c]);
+        }
     }
     printf("\n");
 
     // Do some setup
-    if(rs == RSTYPE_UNIFIED) {
-        scheduler_unified_init(num_registers, rs_size);
-    } else {
-        scheduler_per_fu_init(num_registers, rs_sizes);
+    FILE* pipe_view_fp = NULL;
+    PipeViewWriter* pipe_view = NULL;
+    if (pipe_view_path != NULL) {
+        pipe_view_fp = fopen(pipe_view_path, "w");
+        if (pipe_view_fp == NULL) {
+            fprintf(stderr, "Could not write %s\n", pipe_view_path);
+            return 1;
+        }
+        pipe_view = new PipeViewWriter(pipe_view_fp, &fu_config);
+        sched_options.pipe_view = pipe_view;
     }
-
-
     scheduler_stats_t stats;
     memset(&stats, 0, sizeof(scheduler_stats_t));
-    // For each trace in the file
-    while (!feof(stdin)) { 
-        op_type op = OP_INVALID;
-        int dest = INVALID_REG;
-        int src1 = INVALID_REG;
-        int src2 = INVALID_REG;
-
-        if(process_trace(&op, &dest, &src1, &src2)) {
-            // Retry the same instruction until we're successful
-            bool success = false;
-            do {
-                success = scheduler_try_issue(op, dest, src1, src2, &stats);
-                scheduler_step(&stats);
-            } while(!success);
-        }
-        lineCounter++;
-    }
-    // Wait for the pipeline to drain
-    while(!scheduler_completed()) {
-        scheduler_step(&stats);
-    }
-    scheduler_complete(&stats);
-    print_statistics(&stats);
+    DataflowAnalyzer dataflow(&fu_config);
+    if (num_traces > 0) {
+        // SMT: every trace is a hardware thread of one scheduler
+        if (!simulate_smt(rs, num_registers, rs_size, rs_sizes, argv + optind, num_traces, &stats)) {
+            return 1;
+        }
+    } else {
+        if(rs != RSTYPE_PER_FU) {
+            scheduler_unified_init(num_registers, rs_size);
+        } else {
+            scheduler_per_fu_init(num_registers, rs_sizes);
+        }
+
+        // Each cycle, try to issue the next issue_width instructions of the trace
+        TraceReader reader(STDIN_FILENO, &fu_config);
+        trace_inst_t group[MAX_ISSUE_WIDTH];
+        int pending = 0;
+        bool more = true;
+        while (true) {
+            while (more && pending < issue_width) {
+                more = reader.next(&group[pending]);
+                if (more && verbose_stats) {
+                    dataflow.add(group[pending]);
+                }
+                pending += more ? 1 : 0;
+            }
+            if (pending == 0) {
+                break;
+            }
+            // Retry whatever did not issue in the next cycle
+            int issued = scheduler_try_issue_group(group, pending, &stats);
+            if(issued == 0) {
+                // Nothing can issue until something completes, so jump to that cycle
+                scheduler_skip_idle(&stats, true);
+            }
+            scheduler_step(&stats);
+            memmove(group, group + issued, (pending - issued) * sizeof(trace_inst_t));
+            pending -= issued;
+            lineCounter += issued;
+        }
+        // Wait for the pipeline to drain
+        while(!scheduler_completed()) {
+            scheduler_skip_idle(&stats, false);
+            scheduler_step(&stats);
+        }
+        scheduler_complete(&stats);
+    }
+    if (pipe_view != NULL) {
+        bool written = pipe_view->flush();
+        delete pipe_view;
+        if (fclose(pipe_view_fp) != 0 || !written) {
+            fprintf(stderr, "Could not write %s\n", pipe_view_path);
+            return 1;
+        }
+    }
+    print_statistics(&stats, rs);
+    for (int t = 0; t < num_traces; t++) {
+        printf("Thread %d (%s): %" PRIu64 " insts, %" PRIu64 " cycles, IPC %f\n", t, argv[optind + t],
+               stats.thread_insts[t], stats.thread_cycles[t],
+               stats.thread_cycles[t] ? (double)stats.thread_insts[t] / stats.thread_cycles[t] : 0.0);
+    }
+    // The dataflow limit is per trace, so only for a single one
+    if (verbose_stats && num_traces == 0) {
+        print_dataflow_stats(stdout, &dataflow.stats(), &fu_config);
+    }
+    if (csv_path != NULL && !write_statistics_csv(csv_path, &stats, rs)) {
+        fprintf(stderr, "Could not write %s\n", csv_path);
+        return 1;
+    }
 
     return 0;
 }
 
-void print_statistics(scheduler_stats_t* p_stats) {
+//name of a reservation station in the statistics, its FU class for per-FU ones
+const char* station_name(rs_type rs, int s) {
+    static const char* cluster_names[MAX_CLUSTERS] = {"Cluster 0", "Cluster 1", "Cluster 2", "Cluster 3",
+                                                      "Cluster 4", "Cluster 5", "Cluster 6", "Cluster 7"};
+    if (rs == RSTYPE_CLUSTERED) {
+        return cluster_names[s];
+    }
+    return (rs == RSTYPE_UNIFIED) ? "Unified" : fu_config.classes[s].name;
+}
+
+//number of reservation stations in the statistics
+int station_count(rs_type rs) {
+    if (rs == RSTYPE_CLUSTERED) {
+        return sched_options.num_clusters;
+    }
+    return (rs == RSTYPE_UNIFIED) ? 1 : fu_config.num_classes;
+}
+
+void print_statistics(scheduler_stats_t* p_stats, rs_type rs) {
     printf("Scheduler Statistics\n");
     printf("# Insts: %" PRIu64 "\n", p_stats->num_insts);
     printf("# Cycles: %" PRIu64 "\n", p_stats->num_cycles);
     printf("# IPC: %f\n", p_stats->ipc);
     printf("# Issue Stall: %" PRIu64 "\n", p_stats->issue_stall);
+    if(sched_options.num_physical_regs > 0) {
+        printf("# RS Full Stall: %" PRIu64 "\n", p_stats->rs_full_stall);
+        printf("# Rename Stall: %" PRIu64 "\n", p_stats->rename_stall);
+        printf("# RAW Wait Cycles: %" PRIu64 "\n", p_stats->raw_wait);
+    }
+    if(sched_options.cdb_width > 0) {
+        printf("# Result Bus Utilization: %.2f%%\n",
+               100.0 * p_stats->num_insts / ((double)p_stats->num_cycles * sched_options.cdb_width));
+        printf("# Result Bus Contention Cycles: %" PRIu64 "\n", p_stats->cdb_contention_cycles);
+        printf("# Result Bus Delayed Completions: %" PRIu64 "\n", p_stats->cdb_delayed);
+    }
+    if(sched_options.rob_size > 0) {
+        printf("# ROB Full Stall: %" PRIu64 "\n", p_stats->rob_full_stall);
+        printf("# ROB Avg Occupancy: %f\n", (double)p_stats->rob_occupancy / p_stats->num_cycles);
+        printf("# ROB Max Occupancy: %" PRIu32 "\n", p_stats->max_rob_occupancy);
+        printf("# Max Insts Committed: %" PRIu32 "\n", p_stats->max_committed);
+    }
     printf("# Max Insts Fired: %" PRIu32 "\n", p_stats->max_fired);
     printf("# Max Insts Completed: %" PRIu32 "\n", p_stats->max_completed);
-    printf("ADD FU Max Active: %" PRIu32 "\n", p_stats->max_active[OP_ADD]);
-    printf("DIV FU Max Active: %" PRIu32 "\n", p_stats->max_active[OP_DIV]);
-    printf("MEM FU Max Active: %" PRIu32 "\n", p_stats->max_active[OP_MEM]);
+    for (int c = 0; c < fu_config.num_classes; c++) {
+        printf("%s FU Max Active: %" PRIu32 "\n", fu_config.classes[c].name, p_stats->max_active[c]);
+    }
+    if(rs == RSTYPE_CLUSTERED) {
+        // Imbalance is the busiest cluster's share over an even one, 1 when perfectly balanced
+        std::uint64_t busiest = 0;
+        printf("Cluster Steering\n");
+        for (int k = 0; k < sched_options.num_clusters; k++) {
+            printf("# %s Insts: %" PRIu64 " (%.2f%%)\n", station_name(rs, k), p_stats->cluster_insts[k],
+                   100.0 * p_stats->cluster_insts[k] / p_stats->num_insts);
+            busiest = std::max(busiest, p_stats->cluster_insts[k]);
+        }
+        printf("# Steering Imbalance: %f\n", (double)busiest * sched_options.num_clusters / p_stats->num_insts);
+        printf("# Cross-Cluster Wakeups: %" PRIu64 "\n", p_stats->cross_cluster_wakeups);
+    }
+    if(issue_width > 1) {
+        printf("Issue Width Utilization\n");
+        for (int w = 0; w <= issue_width; w++) {
+            printf("# Cycles Issuing %d: %" PRIu64 " (%.2f%%)\n", w, p_stats->issue_width_hist[w],
+                   100.0 * p_stats->issue_width_hist[w] / p_stats->num_cycles);
+        }
+    }
+    if(!verbose_stats) {
+        return;
+    }
+    printf("Cycles Firing Nothing\n");
+    printf("# Empty: %" PRIu64 "\n", p_stats->no_fire_empty);
+    printf("# RAW Blocked: %" PRIu64 "\n", p_stats->no_fire_raw);
+    printf("# WAW Blocked: %" PRIu64 "\n", p_stats->no_fire_waw);
+    printf("# FU Busy: %" PRIu64 "\n", p_stats->no_fire_fu_busy);
+    printf("# Avg Issue-to-Fire Wait: %f\n",
+           p_stats->num_fired ? (double)p_stats->fire_wait / p_stats->num_fired : 0.0);
+    for (int s = 0; s < station_count(rs); s++) {
+        printf("RS Occupancy %s\n", station_name(rs, s));
+        for (int n = 0; n <= MAX_RS_OCCUPANCY_BUCKET; n++) {
+            if(p_stats->rs_occupancy_hist[s][n] == 0) {
+                continue;
+            }
+            printf("# %d%s Entries: %" PRIu64 " (%.2f%%)\n", n, n == MAX_RS_OCCUPANCY_BUCKET ? "+" : "",
+                   p_stats->rs_occupancy_hist[s][n], 100.0 * p_stats->rs_occupancy_hist[s][n] / p_stats->num_cycles);
+        }
+    }
 }
 
-bool process_trace(op_type* p_op, int* p_dest, int* p_src1, int* p_src2) {
-    char op[16];
+/**
+ * Writes every statistic as stat,station,bucket,value lines, with station and bucket left empty
+ * for the scalar ones.
+ */
+bool write_statistics_csv(const char* path, const scheduler_stats_t* p_stats, rs_type rs) {
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL) {
+        return false;
+    }
+    fprintf(fp, "stat,station,bucket,value\n");
+    const char* names[] = {"insts", "cycles", "issue_stall", "rs_full_stall", "rename_stall", "raw_wait",
+                           "rob_full_stall", "rob_occupancy", "no_fire_empty", "no_fire_raw", "no_fire_waw",
+                           "no_fire_fu_busy", "num_fired", "fire_wait", "cdb_delayed", "cdb_contention_cycles"};
+    const std::uint64_t values[] = {p_stats->num_insts, p_stats->num_cycles, p_stats->issue_stall,
+                                    p_stats->rs_full_stall, p_stats->rename_stall, p_stats->raw_wait,
+                                    p_stats->rob_full_stall, p_stats->rob_occupancy, p_stats->no_fire_empty,
+                                    p_stats->no_fire_raw, p_stats->no_fire_waw, p_stats->no_fire_fu_busy,
+                                    p_stats->num_fired, p_stats->fire_wait, p_stats->cdb_delayed,
+                                    p_stats->cdb_contention_cycles};
+    for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        fprintf(fp, "%s,,,%" PRIu64 "\n", names[i], values[i]);
+    }
+    fprintf(fp, "ipc,,,%f\n", p_stats->ipc);
+    for (int w = 0; w <= MAX_ISSUE_WIDTH; w++) {
+        fprintf(fp, "issue_width,,%d,%" PRIu64 "\n", w, p_stats->issue_width_hist[w]);
+    }
+    for (int s = 0; s < station_count(rs); s++) {
+        for (int n = 0; n <= MAX_RS_OCCUPANCY_BUCKET; n++) {
+            fprintf(fp, "rs_occupancy,%s,%d,%" PRIu64 "\n", station_name(rs, s), n, p_stats->rs_occupancy_hist[s][n]);
+        }
+    }
+    for (int c = 0; c < fu_config.num_classes; c++) {
+        fprintf(fp, "max_active,%s,,%" PRIu32 "\n", fu_config.classes[c].name, p_stats->max_active[c]);
+    }
+    if (rs == RSTYPE_CLUSTERED) {
+        for (int k = 0; k < sched_options.num_clusters; k++) {
+            fprintf(fp, "cluster_insts,%s,,%" PRIu64 "\n", station_name(rs, k), p_stats->cluster_insts[k]);
+        }
+        fprintf(fp, "cross_cluster_wakeups,,,%" PRIu64 "\n", p_stats->cross_cluster_wakeups);
+    }
+    return fclose(fp) == 0;
+}
 
-    int ret = std::fscanf(stdin, "%s %d %d %d\n", op, p_dest, p_src1, p_src2);
-    if(ret == 4) {
-        *p_op = OP_INVALID;
-        if(strcmp(op, "ADD") == 0) {
-            *p_op = OP_ADD;
-        } else if(strcmp(op, "DIV") == 0) {
-            *p_op = OP_DIV;
-        } else if(strcmp(op, "MEM") == 0) {
-            *p_op = OP_MEM;
+/**
+ * Simulates one trace per SMT hardware thread on a shared scheduler. Each cycle the threads are
+ * ranked by the issue policy and fill the issue width in that order, each issuing in order until
+ * one of its instructions does not fit. The aggregate statistics go to p_stats, with per-thread
+ * instruction counts and finishing cycles.
+ */
+bool simulate_smt(rs_type rs, int num_registers, int rs_size, const int rs_sizes[], char* const paths[],
+                  int num_traces, scheduler_stats_t* p_stats) {
+    std::vector<TraceReader*> readers;
+    for (int t = 0; t < num_traces; t++) {
+        int fd = open(paths[t], O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Could not read %s\n", paths[t]);
+            return false;
         }
-        return true;
-    } else {
-        return false;
+        readers.push_back(new TraceReader(fd, &fu_config));
+        // The reader has mapped or copied the trace
+        close(fd);
+    }
+    scheduler_options_t options = sched_options;
+    options.num_threads = num_traces;
+    Scheduler* p_scheduler = (rs != RSTYPE_PER_FU) ? new Scheduler(num_registers, rs_size, &options)
+                                                    : new Scheduler(num_registers, rs_sizes, &options);
+
+    trace_inst_t group[MAX_SMT_THREADS][MAX_ISSUE_WIDTH];
+    int pending[MAX_SMT_THREADS] = {0};
+    bool more[MAX_SMT_THREADS];
+    int order[MAX_SMT_THREADS];
+    std::fill(more, more + num_traces, true);
+    for (int cycle = 0; ; cycle++) {
+        bool left = false;
+        for (int t = 0; t < num_traces; t++) {
+            while (more[t] && pending[t] < issue_width) {
+                more[t] = readers[t]->next(&group[t][pending[t]]);
+                pending[t] += more[t] ? 1 : 0;
+            }
+            left = left || pending[t] > 0;
+        }
+        if (!left) {
+            break;
+        }
+        // Round-robin rotates the first thread every cycle, ICOUNT then favours the emptiest
+        for (int i = 0; i < num_traces; i++) {
+            order[i] = (cycle + i) % num_traces;
+        }
+        if (icount_policy) {
+            std::stable_sort(order, order + num_traces, [p_scheduler](int a, int b) {
+                return p_scheduler->unfired(a) < p_scheduler->unfired(b);
+            });
+        }
+        int slots = issue_width;
+        for (int i = 0; i < num_traces && slots > 0; i++) {
+            int t = order[i];
+            int issued = 0;
+            while (issued < pending[t] && issued < slots &&
+                   p_scheduler->try_issue(group[t][issued].op, group[t][issued].dest, group[t][issued].src1,
+                                          group[t][issued].src2, p_stats, t)) {
+                issued++;
+            }
+            memmove(group[t], group[t] + issued, (pending[t] - issued) * sizeof(trace_inst_t));
+            pending[t] -= issued;
+            slots -= issued;
+        }
+        if (slots < issue_width) {
+            p_stats->issue_width_hist[issue_width - slots]++;
+        }
+        // Every cycle is stepped, since a skip would have to charge a stall per blocked thread
+        p_scheduler->step(p_stats);
+    }
+    while (!p_scheduler->completed()) {
+        p_scheduler->skip_idle(p_stats, false);
+        p_scheduler->step(p_stats);
+    }
+    p_scheduler->complete(p_stats);
+    delete p_scheduler;
+    for (std::size_t t = 0; t < readers.size(); t++) {
+        delete readers[t];
     }
+    return true;
+}
+
+/**
+ * Parses START[:END[:STEP]] into an inclusive range. Returns false if it is malformed or empty.
+ */
+bool parse_range(const char* arg, sweep_range_t* p_range) {
+    int n = std::sscanf(arg, "%d:%d:%d", &p_range->start, &p_range->end, &p_range->step);
+    if (n < 3) {
+        p_range->step = 1;
+    }
+    if (n < 2) {
+        p_range->end = p_range->start;
+    }
+    return n >= 1 && p_range->step > 0 && p_range->start <= p_range->end;
+}
+
+/**
+ * Simulates an in-memory trace on one scheduler, exactly the way main() does for a single run.
+ */
+void simulate_trace(Scheduler* p_scheduler, const std::vector<trace_inst_t>& insts, int width,
+                    scheduler_stats_t* p_stats) {
+    memset(p_stats, 0, sizeof(scheduler_stats_t));
+    std::size_t next = 0;
+    while (next < insts.size()) {
+        int count = (int)std::min<std::size_t>(width, insts.size() - next);
+        int issued = p_scheduler->try_issue_group(&insts[next], count, p_stats);
+        if(issued == 0) {
+            p_scheduler->skip_idle(p_stats, true);
+        }
+        p_scheduler->step(p_stats);
+        next += issued;
+    }
+    while(!p_scheduler->completed()) {
+        p_scheduler->skip_idle(p_stats, false);
+        p_scheduler->step(p_stats);
+    }
+    p_scheduler->complete(p_stats);
+}
+
+/**
+ * Worker loop for the sweep, each configuration gets its own Scheduler.
+ */
+void sweep_worker(std::vector<sweep_job_t>* p_jobs, const std::vector<trace_inst_t>* p_insts,
+                  std::atomic<std::size_t>* p_next) {
+    std::size_t j;
+    while ((j = p_next->fetch_add(1)) < p_jobs->size()) {
+        sweep_job_t& job = (*p_jobs)[j];
+        scheduler_options_t options = sched_options;
+        options.num_physical_regs = job.num_physical_regs;
+        options.rob_size = job.rob_size;
+        options.pipe_view = NULL;
+        if (job.rs != RSTYPE_PER_FU) {
+            Scheduler scheduler(job.num_registers, job.rs_size, &options);
+            simulate_trace(&scheduler, *p_insts, job.width, &job.stats);
+        } else {
+            Scheduler scheduler(job.num_registers, job.rs_sizes, &options);
+            simulate_trace(&scheduler, *p_insts, job.width, &job.stats);
+        }
+    }
+}
+
+/**
+ * Adds a job for every combination of the per-FU RS sizes of classes fu_class and up.
+ */
+void add_per_fu_jobs(sweep_job_t* p_job, const sweep_range_t sizes[], int fu_class, std::vector<sweep_job_t>* p_jobs) {
+    if (fu_class == fu_config.num_classes) {
+        p_jobs->push_back(*p_job);
+        return;
+    }
+    const sweep_range_t& range = sizes[fu_class];
+    for (p_job->rs_sizes[fu_class] = range.start; p_job->rs_sizes[fu_class] <= range.end; p_job->rs_sizes[fu_class] += range.step) {
+        add_per_fu_jobs(p_job, sizes, fu_class + 1, p_jobs);
+    }
+}
+
+/**
+ * Reads the trace on stdin once, simulates every configuration in the ranges across a pool of
+ * threads, and prints one CSV line per configuration in sweep order.
+ */
+int run_sweep(rs_type rs, const sweep_range_t& regs, const sweep_range_t& phys, const sweep_range_t& robs,
+              const sweep_range_t& unified, const sweep_range_t sizes[], const sweep_range_t& widths,
+              unsigned num_threads) {
+    std::vector<trace_inst_t> insts;
+    load_trace(STDIN_FILENO, &insts, &fu_config);
+    // Every configuration is compared against the same dataflow limit
+    DataflowAnalyzer dataflow(&fu_config);
+    for (std::size_t i = 0; i < insts.size(); i++) {
+        dataflow.add(insts[i]);
+    }
+    double ideal_ipc = dataflow.stats().ideal_ipc;
+
+    std::vector<sweep_job_t> jobs;
+    sweep_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.rs = rs;
+    for (job.width = widths.start; job.width <= widths.end; job.width += widths.step) {
+        for (job.num_registers = regs.start; job.num_registers <= regs.end; job.num_registers += regs.step) {
+            for (job.num_physical_regs = phys.start; job.num_physical_regs <= phys.end; job.num_physical_regs += phys.step) {
+                for (job.rob_size = robs.start; job.rob_size <= robs.end; job.rob_size += robs.step) {
+                    if (rs != RSTYPE_PER_FU) {
+                        for (job.rs_size = unified.start; job.rs_size <= unified.end; job.rs_size += unified.step) {
+                            jobs.push_back(job);
+                        }
+                        continue;
+                    }
+                    add_per_fu_jobs(&job, sizes, 0, &jobs);
+                }
+            }
+        }
+    }
+
+    std::atomic<std::size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < num_threads && i < jobs.size(); i++) {
+        workers.push_back(std::thread(sweep_worker, &jobs, &insts, &next));
+    }
+    for (std::size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    // One rs_<class> column per FU class, rs_add,rs_div,rs_mem by default
+    printf("type,width,regs,phys,rob,rs_unified,");
+    for (int c = 0; c < fu_config.num_classes; c++) {
+        printf("rs_");
+        for (const char* p = fu_config.classes[c].name; *p != '\0'; p++) {
+            putchar(tolower(*p));
+        }
+        putchar(',');
+    }
+    printf("insts,cycles,ipc,issue_stall,rs_full_stall,rename_stall,raw_wait,rob_full_stall,rob_avg,ideal_ipc\n");
+    for (std::size_t j = 0; j < jobs.size(); j++) {
+        const sweep_job_t& r = jobs[j];
+        if (r.rs != RSTYPE_PER_FU) {
+            printf("%c,%d,%d,%d,%d,%d,", static_cast<char>(r.rs), r.width, r.num_registers, r.num_physical_regs,
+                   r.rob_size, r.rs_size);
+            for (int c = 0; c < fu_config.num_classes; c++) {
+                putchar(',');
+            }
+        } else {
+            printf("%c,%d,%d,%d,%d,,", static_cast<char>(r.rs), r.width, r.num_registers, r.num_physical_regs,
+                   r.rob_size);
+            for (int c = 0; c < fu_config.num_classes; c++) {
+                printf("%d,", r.rs_sizes[c]);
+            }
+        }
+        printf("%" PRIu64 ",%" PRIu64 ",%f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%f,%f\n",
+               r.stats.num_insts, r.stats.num_cycles, r.stats.ipc, r.stats.issue_stall, r.stats.rs_full_stall,
+               r.stats.rename_stall, r.stats.raw_wait, r.stats.rob_full_stall,
+               (double)r.stats.rob_occupancy / r.stats.num_cycles, ideal_ipc);
+    }
+    return 0;
 }
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include "schedulersim_latency.hpp"
+
+/**
+ * Subroutine that builds the sampler for an FU class
+ *
+ * @param[in]   fu          The FU class
+ * @param[in]   seed        Seed, already distinct per class
+ *
+ * @return                  the new model, or NULL if the class always takes its fixed latency
+ */
+LatencyModel* LatencyModel::create(const fu_class_t& fu, std::uint64_t seed) {
+    switch (fu.latency_model.type) {
+    case LATENCY_HIT_MISS:
+        return new HitMissLatency(fu.latency_model, seed);
+    case LATENCY_HISTOGRAM:
+        return new HistogramLatency(fu.latency_model, seed);
+    default:
+        return NULL;
+    }
+}
+
+//splitmix64, which is small, fast and gives the same sequence everywhere
+std::uint64_t LatencyModel::next_random() {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+HitMissLatency::HitMissLatency(const fu_latency_model_t& model, std::uint64_t seed)
+    : LatencyModel(seed), hit_latency(model.hit_latency), miss_latency(model.miss_latency),
+      miss_percent(model.miss_percent) {
+}
+
+int HitMissLatency::sample() {
+    return (int)(next_random() % 100) < miss_percent ? miss_latency : hit_latency;
+}
+
+HistogramLatency::HistogramLatency(const fu_latency_model_t& model, std::uint64_t seed) : LatencyModel(seed) {
+    std::uint64_t total = 0;
+    for (int b = 0; b < model.num_buckets; b++) {
+        total += model.bucket_weight[b];
+        latencies.push_back(model.bucket_latency[b]);
+        cumulative.push_back(total);
+    }
+}
+
+int HistogramLatency::sample() {
+    //the first bucket whose cumulative weight passes a uniform draw below the total
+    std::uint64_t r = next_random() % cumulative.back();
+    std::size_t b = std::upper_bound(cumulative.begin(), cumulative.end(), r) - cumulative.begin();
+    return latencies[b];
+}
@@ -0,0 +1,50 @@
+#ifndef SCHEDULERSIM_LATENCY_HPP
+#define SCHEDULERSIM_LATENCY_HPP
+
+#include <cstdint>
+#include <vector>
+#include "schedulersim.hpp"
+
+/**
+ * Draws the latency of each instruction of an FU class with a variable latency. Every model has
+ * its own seeded generator, so a run is repeatable and independent of the other classes.
+ */
+class LatencyModel {
+public:
+    virtual ~LatencyModel() {}
+    virtual int sample() = 0;
+
+    static LatencyModel* create(const fu_class_t& fu, std::uint64_t seed);
+
+protected:
+    explicit LatencyModel(std::uint64_t seed) : state(seed) {}
+    std::uint64_t next_random();
+
+private:
+    std::uint64_t state;
+};
+
+//a hit latency, or the miss latency for miss_percent of the instructions
+class HitMissLatency : public LatencyModel {
+public:
+    HitMissLatency(const fu_latency_model_t& model, std::uint64_t seed);
+    int sample();
+
+private:
+    int hit_latency;
+    int miss_latency;
+    int miss_percent;
+};
+
+//latencies drawn in proportion to the weights of an empirical histogram
+class HistogramLatency : public LatencyModel {
+public:
+    HistogramLatency(const fu_latency_model_t& model, std::uint64_t seed);
+    int sample();
+
+private:
+    std::vector<int> latencies;
+    std::vector<std::uint64_t> cumulative;
+};
+
+#endif /* SCHEDULERSIM_LATENCY_HPP */
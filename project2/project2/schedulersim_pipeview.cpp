@@ -0,0 +1,105 @@
+#include <cinttypes>
+#include "schedulersim_pipeview.hpp"
+
+PipeViewWriter::PipeViewWriter(std::FILE* fp, const fu_config_t* p_config)
+    : fp(fp), windowBase(0), block(PIPEVIEW_BLOCK_SIZE), used(0), failed(false) {
+    if (p_config != NULL) {
+        config = *p_config;
+    } else {
+        fu_config_default(&config);
+    }
+}
+
+PipeViewWriter::~PipeViewWriter() {
+    flush();
+}
+
+/**
+ * Subroutine that records an instruction's cycles once it completes
+ *
+ * @param[in]   seq         Its position in issue order, from 0
+ * @param[in]   inst        The instruction
+ * @param[in]   issued      Cycle it was issued into a reservation station
+ * @param[in]   fired       Cycle it fired
+ * @param[in]   completed   Cycle it completed
+ * @param[in]   retired     true if it retires on completion, else retired() follows
+ */
+void PipeViewWriter::completed(std::uint64_t seq, const trace_inst_t& inst, int issued, int fired, int completed,
+                               bool retired) {
+    std::size_t i = seq - windowBase;
+    if (i >= window.size()) {
+        window.resize(i + 1);
+    }
+    record& r = window[i];
+    r.inst = inst;
+    r.issued = issued;
+    r.fired = fired;
+    r.completed = completed;
+    r.retired = retired ? completed : -1;
+    r.known = true;
+    drain();
+}
+
+/**
+ * Subroutine that records the commit of a completed instruction
+ *
+ * @param[in]   seq         Its position in issue order, from 0
+ * @param[in]   cycle       Cycle it committed
+ */
+void PipeViewWriter::retired(std::uint64_t seq, int cycle) {
+    window[seq - windowBase].retired = cycle;
+    drain();
+}
+
+//writes out the oldest instructions for as long as they have retired
+void PipeViewWriter::drain() {
+    while (!window.empty() && window.front().known && window.front().retired != -1) {
+        emit(windowBase, window.front());
+        window.pop_front();
+        windowBase++;
+    }
+}
+
+void PipeViewWriter::emit(std::uint64_t seq, const record& r) {
+    //room for one instruction's lines
+    if (used + 512 > block.size()) {
+        flush();
+    }
+    //the disassembly names only the registers the instruction uses
+    char text[64];
+    int length = std::snprintf(text, sizeof(text), "%s r%d", config.classes[r.inst.op].name, r.inst.dest);
+    if (r.inst.src1 != INVALID_REG) {
+        length += std::snprintf(text + length, sizeof(text) - length, ", r%d", r.inst.src1);
+    }
+    if (r.inst.src2 != INVALID_REG) {
+        std::snprintf(text + length, sizeof(text) - length, ", r%d", r.inst.src2);
+    }
+    std::uint64_t issue = (std::uint64_t)r.issued * PIPEVIEW_TICKS_PER_CYCLE;
+    char* p = block.data() + used;
+    int n = std::snprintf(p, block.size() - used,
+                          "O3PipeView:fetch:%" PRIu64 ":0x%08" PRIx64 ":0:%" PRIu64 ":%s\n"
+                          "O3PipeView:decode:%" PRIu64 "\n"
+                          "O3PipeView:rename:%" PRIu64 "\n"
+                          "O3PipeView:dispatch:%" PRIu64 "\n"
+                          "O3PipeView:issue:%" PRIu64 "\n"
+                          "O3PipeView:complete:%" PRIu64 "\n"
+                          "O3PipeView:retire:%" PRIu64 ":store:0\n",
+                          issue, seq * 4, seq + 1, text, issue, issue, issue,
+                          (std::uint64_t)r.fired * PIPEVIEW_TICKS_PER_CYCLE,
+                          (std::uint64_t)r.completed * PIPEVIEW_TICKS_PER_CYCLE,
+                          (std::uint64_t)r.retired * PIPEVIEW_TICKS_PER_CYCLE);
+    used += n;
+}
+
+/**
+ * Subroutine that writes out the collected block
+ *
+ * @return                  false if any write so far has failed
+ */
+bool PipeViewWriter::flush() {
+    if (used > 0 && std::fwrite(block.data(), 1, used, fp) != used) {
+        failed = true;
+    }
+    used = 0;
+    return !failed && std::fflush(fp) == 0;
+}
@@ -0,0 +1,56 @@
+#ifndef SCHEDULERSIM_PIPEVIEW_HPP
+#define SCHEDULERSIM_PIPEVIEW_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+#include "schedulersim.hpp"
+
+//ticks per cycle in the O3PipeView log, as gem5 writes them
+const static int PIPEVIEW_TICKS_PER_CYCLE = 1000;
+//bytes of log text collected before each write
+const static int PIPEVIEW_BLOCK_SIZE = 1 << 16;
+
+/**
+ * Writes the life of every instruction as a gem5 O3PipeView log, which pipeline visualizers such as
+ * Konata read. Issue into the scheduler is the fetch through dispatch stages, fire is issue, then
+ * complete and retire (commit with a reorder buffer, else completion). Instructions are written in
+ * issue order as soon as they and every older one have retired, collected into blocks of text, so
+ * only the instructions in flight are held in memory.
+ */
+class PipeViewWriter {
+public:
+    explicit PipeViewWriter(std::FILE* fp, const fu_config_t* p_config = NULL);
+    PipeViewWriter(const PipeViewWriter&) = delete;
+    PipeViewWriter& operator=(const PipeViewWriter&) = delete;
+    ~PipeViewWriter();
+
+    void completed(std::uint64_t seq, const trace_inst_t& inst, int issued, int fired, int completed, bool retired);
+    void retired(std::uint64_t seq, int cycle);
+    bool flush();
+
+private:
+    struct record {
+        trace_inst_t inst;
+        int issued;
+        int fired;
+        int completed;
+        int retired;    //-1 until it retires
+        bool known;     //completed() has been called for it
+    };
+
+    void emit(std::uint64_t seq, const record& r);
+    void drain();
+
+    std::FILE* fp;
+    fu_config_t config;
+    //instructions from windowBase on in issue order, not yet written
+    std::deque<record> window;
+    std::uint64_t windowBase;
+    std::vector<char> block;
+    std::size_t used;
+    bool failed;
+};
+
+#endif /* SCHEDULERSIM_PIPEVIEW_HPP */
@@ -0,0 +1,162 @@
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "schedulersim_trace.hpp"
+
+TraceReader::TraceReader(int fd, const fu_config_t* p_config)
+    : data(NULL), size(0), pos(0), mapped(false), is_binary(false) {
+    if (p_config != NULL) {
+        config = *p_config;
+    } else {
+        fu_config_default(&config);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, st.st_size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(p);
+            size = st.st_size;
+            mapped = true;
+        }
+    }
+    if (!mapped) {
+        char chunk[1 << 16];
+        ssize_t n;
+        while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+            buffer.insert(buffer.end(), chunk, chunk + n);
+        }
+        data = buffer.data();
+        size = buffer.size();
+    }
+    if (size >= sizeof(TRACE_BINARY_MAGIC) && memcmp(data, TRACE_BINARY_MAGIC, sizeof(TRACE_BINARY_MAGIC)) == 0) {
+        is_binary = true;
+        pos = sizeof(TRACE_BINARY_MAGIC);
+    }
+}
+
+TraceReader::~TraceReader() {
+    if (mapped) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+/**
+ * Subroutine that reads the next instruction of the trace
+ *
+ * @param[out]  p_inst      The instruction
+ *
+ * @return                  false once the trace is exhausted
+ */
+bool TraceReader::next(trace_inst_t* p_inst) {
+    if (!is_binary) {
+        return next_text(p_inst);
+    }
+    if (size - pos < (std::size_t)TRACE_BINARY_RECORD_SIZE) {
+        return false;
+    }
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(data + pos);
+    pos += TRACE_BINARY_RECORD_SIZE;
+    p_inst->op = (b[0] == TRACE_BINARY_NO_REG) ? OP_INVALID : static_cast<op_type>(b[0]);
+    p_inst->dest = (b[1] == TRACE_BINARY_NO_REG) ? INVALID_REG : b[1];
+    p_inst->src1 = (b[2] == TRACE_BINARY_NO_REG) ? INVALID_REG : b[2];
+    p_inst->src2 = (b[3] == TRACE_BINARY_NO_REG) ? INVALID_REG : b[3];
+    return true;
+}
+
+//parses an optionally negative decimal after any whitespace, like fscanf's %d
+bool TraceReader::parse_int(int* p_value) {
+    while (pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n')) {
+        pos++;
+    }
+    bool negative = pos < size && data[pos] == '-';
+    if (negative) {
+        pos++;
+    }
+    if (pos >= size || data[pos] < '0' || data[pos] > '9') {
+        return false;
+    }
+    int value = 0;
+    while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+        value = value * 10 + (data[pos] - '0');
+        pos++;
+    }
+    *p_value = negative ? -value : value;
+    return true;
+}
+
+bool TraceReader::next_text(trace_inst_t* p_inst) {
+    while (true) {
+        while (pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n')) {
+            pos++;
+        }
+        if (pos >= size) {
+            return false;
+        }
+        //opcode token
+        std::size_t start = pos;
+        while (pos < size && data[pos] != ' ' && data[pos] != '\t' && data[pos] != '\r' && data[pos] != '\n') {
+            pos++;
+        }
+        std::size_t length = pos - start;
+        p_inst->op = OP_INVALID;
+        for (int i = 0; i < config.num_opcodes; i++) {
+            const char* name = config.opcodes[i].name;
+            if (strncmp(name, data + start, length) == 0 && name[length] == '\0') {
+                p_inst->op = static_cast<op_type>(config.opcodes[i].fu_class);
+                break;
+            }
+        }
+        if (parse_int(&p_inst->dest) && parse_int(&p_inst->src1) && parse_int(&p_inst->src2)) {
+            return true;
+        }
+        //malformed line, skip the rest of it
+        while (pos < size && data[pos] != '\n') {
+            pos++;
+        }
+    }
+}
+
+/**
+ * Subroutine that reads a whole trace into memory
+ *
+ * @param[in]   fd          The trace file descriptor
+ * @param[out]  p_insts     The instructions, in trace order
+ * @param[in]   p_config    FU configuration mapping text opcodes (NULL for the default)
+ *
+ * @return                  true if at least one instruction was read
+ */
+bool load_trace(int fd, std::vector<trace_inst_t>* p_insts, const fu_config_t* p_config) {
+    TraceReader reader(fd, p_config);
+    trace_inst_t inst;
+    while (reader.next(&inst)) {
+        p_insts->push_back(inst);
+    }
+    return !p_insts->empty();
+}
+
+/**
+ * Subroutine that writes one instruction in the binary trace format
+ *
+ * @param[in]   fp          The output file, already holding TRACE_BINARY_MAGIC
+ * @param[in]   inst        The instruction
+ *
+ * @return                  false if a register does not fit in a byte or the write failed
+ */
+bool write_trace_record(std::FILE* fp, const trace_inst_t& inst) {
+    int regs[] = {inst.dest, inst.src1, inst.src2};
+    unsigned char b[TRACE_BINARY_RECORD_SIZE];
+    b[0] = (inst.op == OP_INVALID) ? TRACE_BINARY_NO_REG : inst.op;
+    for (int k = 0; k < 3; k++) {
+        if (regs[k] == INVALID_REG) {
+            b[k + 1] = TRACE_BINARY_NO_REG;
+        } else if (regs[k] >= 0 && regs[k] < TRACE_BINARY_NO_REG) {
+            b[k + 1] = regs[k];
+        } else {
+            return false;
+        }
+    }
+    return std::fwrite(b, 1, sizeof(b), fp) == sizeof(b);
+}
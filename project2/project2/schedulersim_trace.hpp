@@ -0,0 +1,50 @@
+#ifndef SCHEDULERSIM_TRACE_HPP
+#define SCHEDULERSIM_TRACE_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include "schedulersim.hpp"
+
+/**
+ * Binary traces are TRACE_BINARY_MAGIC followed by one 4-byte record per instruction: the opcode
+ * (an op_type, so an FU class index), then the destination and the two source registers as
+ * unsigned bytes, with TRACE_BINARY_NO_REG standing for INVALID_REG.
+ */
+const static unsigned char TRACE_BINARY_MAGIC[8] = {0x7f, 'S', 'C', 'T', 1, 0, 0, 0};
+const static int TRACE_BINARY_RECORD_SIZE = 4;
+const static int TRACE_BINARY_NO_REG = 0xff;
+
+/**
+ * Reads a text or binary trace (told apart by the magic) from a file descriptor. Regular files are
+ * mapped into memory, anything else (like a pipe) is read in full first. Text lines are
+ * "OP RD RS RT" as in the original traces, parsed by hand rather than with fscanf, with OP mapped
+ * to an FU class by the opcodes of the FU configuration.
+ */
+class TraceReader {
+public:
+    explicit TraceReader(int fd, const fu_config_t* p_config = NULL);
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+    ~TraceReader();
+
+    bool binary() const { return is_binary; }
+    bool next(trace_inst_t* p_inst);
+
+private:
+    bool next_text(trace_inst_t* p_inst);
+    bool parse_int(int* p_value);
+
+    const char* data;
+    std::size_t size;
+    std::size_t pos;
+    bool mapped;
+    bool is_binary;
+    std::vector<char> buffer;
+    fu_config_t config;
+};
+
+bool load_trace(int fd, std::vector<trace_inst_t>* p_insts, const fu_config_t* p_config = NULL);
+bool write_trace_record(std::FILE* fp, const trace_inst_t& inst);
+
+#endif /* SCHEDULERSIM_TRACE_HPP */
@@ -0,0 +1,36 @@
+#!/bin/sh
+binary="./schedulersim"
+converter="./schedulersim_convert"
+
+validate_round_trip() {
+    trace_name=$1
+    config=$2
+
+    config_name=`basename ${config} .cfg`
+
+    # text -> binary -> text must give back the trace and simulate the same way
+    ${converter} -c ${config} < test-traces/${trace_name}.trc > myoutput/${trace_name}_${config_name}.btrc
+    ${converter} -t -c ${config} < myoutput/${trace_name}_${config_name}.btrc > myoutput/${trace_name}_${config_name}.trc
+    diff test-traces/${trace_name}.trc myoutput/${trace_name}_${config_name}.trc
+    ${binary} -c ${config} -u6 < test-traces/${trace_name}.trc > myoutput/${trace_name}_${config_name}_text.out
+    ${binary} -c ${config} -u6 < myoutput/${trace_name}_${config_name}.trc > myoutput/${trace_name}_${config_name}_round_trip.out
+    diff myoutput/${trace_name}_${config_name}_text.out myoutput/${trace_name}_${config_name}_round_trip.out
+}
+
+for executable in "${binary}" "${converter}"
+do
+    if [ ! -f "${executable}" ]
+    then
+        echo "Executable ${executable}" not found
+        exit 1
+    fi
+done
+
+rm -rf myoutput
+mkdir myoutput
+
+for trace_name in "all-independent" "complete-chain" "multi-fire"
+do
+    validate_round_trip "$trace_name" "fu-configs/default.cfg"
+    validate_round_trip "$trace_name" "fu-configs/wide.cfg"
+done